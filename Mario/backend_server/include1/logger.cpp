@@ -1,10 +0,0 @@
-#include "logger.hpp"
-#include <iostream>
-
-void Logger::info(const std::string& msg) {
-    std::cout << "[INFO] " << msg << std::endl;
-}
-
-void Logger::error(const std::string& msg) {
-    std::cerr << "[ERROR] " << msg << std::endl;
-}
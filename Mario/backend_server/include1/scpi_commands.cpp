@@ -0,0 +1,43 @@
+#include "scpi_commands.hpp"
+#include <string_view>
+#include "../../../controller/scpi_parser.hpp"
+
+using json = nlohmann::json;
+
+LatencyHistograms scpiLatency({"request", "scpi_parse", "path_lookup"});
+
+json config = {
+    {"paths", {
+        { {"id", 1}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 1} },
+        { {"id", 2}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 2} },
+        { {"id", 3}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 3} },
+        { {"id", 4}, {"component_id", "switch2"}, {"address", 268436480}, {"gpio_value", 4} }
+    }}
+};
+
+std::string sendCommand(const std::string &cmd) {
+    // Handle ":ROUTE:PATH n" or ":ROUTE:PATH? n" (short form ROUT and any case accepted)
+    scpi::ParsedCommand parsed;
+    {
+        LatencyHistograms::Scope timing(scpiLatency, kScpiStageParse);
+        parsed = scpi::parse(cmd);
+    }
+    if (parsed.command == scpi::Command::RoutePath) {
+        std::string_view args = parsed.args;
+        int requested_id;
+        if (!scpi::parse_number(scpi::next_argument(args), requested_id)) {
+            return R"({"error":"Invalid SCPI command format"})";
+        }
+
+        // Look for a matching path in config
+        LatencyHistograms::Scope timing(scpiLatency, kScpiStagePathLookup);
+        for (auto &path : config["paths"]) {
+            if (path["id"] == requested_id) {
+                // ✅ Always return the whole JSON object
+                return path.dump();
+            }
+        }
+        return R"({"error":"Path ID not found"})";
+    }
+    return R"({"error":"Unknown SCPI command"})";
+}
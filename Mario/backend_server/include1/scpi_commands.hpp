@@ -0,0 +1,18 @@
+#ifndef SCPI_COMMANDS_HPP
+#define SCPI_COMMANDS_HPP
+
+#include <json.hpp>   // nlohmann/json
+#include <string>
+#include "../../../controller/latency_histograms.hpp"
+
+// Where the time of a /scpi request goes; GET /metrics
+enum ScpiStage { kScpiStageRequest, kScpiStageParse, kScpiStagePathLookup };
+extern LatencyHistograms scpiLatency;
+
+// Hardcoded SCPI paths
+extern nlohmann::json config;
+
+// Very basic SCPI command handler: ":ROUTE:PATH n" returns the path's JSON object
+std::string sendCommand(const std::string &cmd);
+
+#endif
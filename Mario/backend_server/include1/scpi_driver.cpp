@@ -1,64 +1,252 @@
 #include "scpi_driver.hpp"
-#include <iostream>
+#include <chrono>
 #include <cstring>
 #ifdef _WIN32
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
+#define poll WSAPoll
 #else
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <unistd.h>
 #endif
 
-SCPIDriver::SCPIDriver() : sockfd(-1), connected(false) {
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // a dropped instrument must not kill us with SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr int kDefaultTimeoutMs = 1500;
+constexpr size_t kReadChunk = 4096;
+
+void closeSocket(int fd) {
 #ifdef _WIN32
-    WSADATA wsa;
-    WSAStartup(MAKEWORD(2,2), &wsa);
+    closesocket(fd);
+#else
+    close(fd);
 #endif
 }
 
-SCPIDriver::~SCPIDriver() {
-    if (connected) {
+bool setBlocking(int fd, bool blocking) {
 #ifdef _WIN32
-        closesocket(sockfd);
-        WSACleanup();
+    u_long mode = blocking ? 0 : 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0;
 #else
-        close(sockfd);
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(fd, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK)) == 0;
 #endif
-    }
 }
 
-bool SCPIDriver::connect(const std::string& host, int port) {
+// connect() bounded by timeoutMs: an unreachable chassis would otherwise
+// block for the kernel's SYN retries (about two minutes)
+bool connectWithin(int fd, const sockaddr* addr, socklen_t len, int timeoutMs) {
+    if (!setBlocking(fd, false)) return false;
+    if (::connect(fd, addr, len) != 0) {
 #ifdef _WIN32
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (WSAGetLastError() != WSAEWOULDBLOCK) return false;
 #else
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+        if (errno != EINPROGRESS) return false;
+#endif
+        pollfd pfd{};
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+        int err = 0;
+        socklen_t errLen = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &errLen) != 0 || err != 0) {
+            return false;
+        }
+    }
+    return setBlocking(fd, true);
+}
+
+} // namespace
+
+SCPIDriver::SCPIDriver() : sockfd(-1), connected(false), port(0), timeoutMs(kDefaultTimeoutMs) {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2,2), &wsa);
 #endif
-    if (sockfd < 0) return false;
+}
 
-    sockaddr_in server{};
-    server.sin_family = AF_INET;
-    server.sin_port = htons(port);
-    server.sin_addr.s_addr = inet_addr(host.c_str());
+SCPIDriver::~SCPIDriver() {
+    disconnect();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool SCPIDriver::connect(const std::string& host, int port) {
+    disconnect();
+    this->host = host;
+    this->port = port;
+    return ensureConnected();
+}
+
+void SCPIDriver::disconnect() {
+    if (sockfd >= 0) {
+        closeSocket(sockfd);
+    }
+    sockfd = -1;
+    connected = false;
+    rxBuffer.clear();
+}
 
-    if (::connect(sockfd, (sockaddr*)&server, sizeof(server)) < 0) {
+void SCPIDriver::fail(const std::string& what) {
+    error = what;
+    disconnect();
+}
+
+bool SCPIDriver::ensureConnected() {
+    if (connected) return true;
+    if (host.empty()) {
+        error = "No target set";
+        return false;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0 || !result) {
+        error = "Cannot resolve " + host;
         return false;
     }
 
+    sockfd = static_cast<int>(socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    if (sockfd < 0) {
+        freeaddrinfo(result);
+        error = "socket() failed";
+        return false;
+    }
+    bool ok = connectWithin(sockfd, result->ai_addr, static_cast<socklen_t>(result->ai_addrlen), timeoutMs);
+    freeaddrinfo(result);
+    if (!ok) {
+        fail("Cannot connect to " + host + ":" + service);
+        return false;
+    }
+
+    // Commands are small and latency bound: don't let Nagle hold them back
+    int one = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+
     connected = true;
     return true;
 }
 
+bool SCPIDriver::writeAll(const std::string& data, size_t& sent) {
+    sent = 0;
+    while (sent < data.size()) {
+        int n = send(sockfd, data.data() + sent, static_cast<int>(data.size() - sent), kSendFlags);
+        if (n <= 0) {
+            fail("send() failed");
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool SCPIDriver::readLine(std::string& line) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    size_t scanned = 0;
+    for (;;) {
+        size_t newline = rxBuffer.find('\n', scanned);
+        if (newline != std::string::npos) {
+            size_t end = newline;
+            if (end > 0 && rxBuffer[end - 1] == '\r') --end;
+            line.assign(rxBuffer, 0, end);
+            rxBuffer.erase(0, newline + 1);
+            return true;
+        }
+        scanned = rxBuffer.size();
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            fail("Timed out waiting for reply");
+            return false;
+        }
+        pollfd pfd{};
+        pfd.fd = sockfd;
+        pfd.events = POLLIN;
+        int ready = poll(&pfd, 1, static_cast<int>(remaining));
+        if (ready <= 0) {
+            if (ready == 0) continue;  // deadline check above reports the timeout
+            fail("poll() failed");
+            return false;
+        }
+
+        // Grow the buffer in place and read straight into it
+        size_t used = rxBuffer.size();
+        rxBuffer.resize(used + kReadChunk);
+        int n = recv(sockfd, &rxBuffer[used], static_cast<int>(kReadChunk), 0);
+        if (n <= 0) {
+            rxBuffer.resize(used);
+            fail(n == 0 ? "Connection closed by instrument" : "recv() failed");
+            return false;
+        }
+        rxBuffer.resize(used + static_cast<size_t>(n));
+    }
+}
+
+void SCPIDriver::dropIfStale() {
+    if (!connected) return;
+    // An idle instrument connection that was closed by the peer reads as EOF
+    pollfd pfd{};
+    pfd.fd = sockfd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) <= 0) return;
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        fail("Connection dropped");
+        return;
+    }
+    char probe;
+    if ((pfd.revents & POLLIN) && recv(sockfd, &probe, 1, MSG_PEEK) == 0) {
+        fail("Connection closed by instrument");
+    }
+}
+
 std::string SCPIDriver::sendCommand(const std::string& cmd) {
-    if (!connected) return "Not connected";
+    dropIfStale();
+    if (!ensureConnected()) return "Not connected";
+    return sendPipelined({cmd})[0];
+}
+
+std::vector<std::string> SCPIDriver::sendPipelined(const std::vector<std::string>& cmds) {
+    std::vector<std::string> replies(cmds.size());
+    if (cmds.empty()) return replies;
 
-    send(sockfd, cmd.c_str(), cmd.size(), 0);
+    std::string batch;
+    for (const auto& cmd : cmds) {
+        batch += cmd;
+        if (cmd.empty() || cmd.back() != '\n') batch += '\n';
+    }
+
+    // A connection that died since the last exchange is re-opened; a failed
+    // write is retried on a fresh connection only if nothing reached the wire,
+    // so a command is never executed twice
+    dropIfStale();
+    if (!ensureConnected()) return replies;
+    size_t sent = 0;
+    if (!writeAll(batch, sent)) {
+        if (sent != 0 || !ensureConnected() || !writeAll(batch, sent)) return replies;
+    }
 
-    char buffer[1024] = {0};
-    int n = recv(sockfd, buffer, sizeof(buffer)-1, 0);
-    if (n > 0) {
-        buffer[n] = '\0';
-        return std::string(buffer);
+    for (auto& reply : replies) {
+        if (!readLine(reply)) break;
     }
-    return "";
+    return replies;
 }
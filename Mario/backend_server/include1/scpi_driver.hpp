@@ -1,19 +1,55 @@
 #ifndef SCPI_DRIVER_HPP
 #define SCPI_DRIVER_HPP
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
+// Persistent SCPI-over-TCP connection to one instrument (e.g. Ramiro/fake_fpga
+// on port 5025). Commands and replies are newline framed. The connection is
+// kept open between commands and re-established on the next command after an
+// error or timeout.
 class SCPIDriver {
 public:
     SCPIDriver();
     ~SCPIDriver();
 
+    SCPIDriver(const SCPIDriver&) = delete;
+    SCPIDriver& operator=(const SCPIDriver&) = delete;
+
     bool connect(const std::string& host, int port);
+    void disconnect();
+    bool isConnected() const { return connected; }
+
+    // Per-reply timeout, also the limit for opening the connection; a timed
+    // out connection is dropped so late replies cannot be matched to the
+    // wrong command
+    void setTimeout(int timeout_ms) { timeoutMs = timeout_ms; }
+
+    // Sends one command and returns its reply line without the terminator.
+    // Returns "Not connected" if no connection can be made, "" on timeout or error.
     std::string sendCommand(const std::string& cmd);
 
+    // Writes all commands in one go, then reads one reply per command, in
+    // order. Missing replies (timeout, connection lost) come back as "".
+    std::vector<std::string> sendPipelined(const std::vector<std::string>& cmds);
+
+    const std::string& lastError() const { return error; }
+
 private:
+    bool ensureConnected();
+    void dropIfStale();
+    bool writeAll(const std::string& data, size_t& sent);
+    bool readLine(std::string& line);
+    void fail(const std::string& what);
+
     int sockfd;  // socket handle
     bool connected;
+    std::string host;
+    int port;
+    int timeoutMs;
+    std::string rxBuffer;  // bytes received past the last returned line
+    std::string error;
 };
 
 #endif
@@ -0,0 +1,395 @@
+#include "scpi_pool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef _WIN32
+#error "SCPIDriverPool needs POSIX sockets; use SCPIDriver on Windows"
+#endif
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr int kDefaultTimeoutMs = 1500;
+constexpr size_t kReadChunk = 4096;
+
+void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// SOCK_CLOEXEC is Linux and BSD only; this works wherever the poll() loop does
+void setCloseOnExec(int fd) {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD, 0) | FD_CLOEXEC);
+}
+
+} // namespace
+
+SCPIDriverPool::SCPIDriverPool()
+    : timeoutMs(kDefaultTimeoutMs), stopping(false), pollFd(-1), wakeRead(-1), wakeWrite(-1) {
+    int fds[2];
+    if (pipe(fds) == 0) {
+        wakeRead = fds[0];
+        wakeWrite = fds[1];
+        setNonBlocking(wakeRead);
+        setNonBlocking(wakeWrite);
+        setCloseOnExec(wakeRead);
+        setCloseOnExec(wakeWrite);
+    }
+#ifdef __linux__
+    pollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeRead;
+    epoll_ctl(pollFd, EPOLL_CTL_ADD, wakeRead, &ev);
+#endif
+    loop = std::thread(&SCPIDriverPool::run, this);
+}
+
+SCPIDriverPool::~SCPIDriverPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    char wake = 1;
+    ssize_t ignored = write(wakeWrite, &wake, 1);
+    (void)ignored;
+    loop.join();
+    if (pollFd >= 0) close(pollFd);
+    close(wakeRead);
+    close(wakeWrite);
+}
+
+void SCPIDriverPool::setTimeout(int timeout_ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    timeoutMs = timeout_ms;
+}
+
+void SCPIDriverPool::sendCommand(const std::string& host, int port, const std::string& cmd, Callback done) {
+    Submission submission;
+    submission.key = host + ":" + std::to_string(port);
+    submission.host = host;
+    submission.port = port;
+    submission.resolved = resolve(submission.key, host, port, submission.address);
+    submission.exchange.command = cmd;
+    submission.exchange.done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submission.exchange.timeout = std::chrono::milliseconds(timeoutMs);
+        submissions.push_back(std::move(submission));
+    }
+    char wake = 1;
+    ssize_t ignored = write(wakeWrite, &wake, 1);
+    (void)ignored;
+}
+
+std::future<SCPIReply> SCPIDriverPool::sendCommand(const std::string& host, int port, const std::string& cmd) {
+    auto promise = std::make_shared<std::promise<SCPIReply>>();
+    std::future<SCPIReply> reply = promise->get_future();
+    sendCommand(host, port, cmd, [promise](const SCPIReply& r) { promise->set_value(r); });
+    return reply;
+}
+
+// Runs on the submitting thread. Only the first command to a host:port pays
+// for getaddrinfo; the loop forgets the address when connecting to it fails.
+bool SCPIDriverPool::resolve(const std::string& key, const std::string& host, int port, sockaddr_in& address) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = addresses.find(key);
+        if (it != addresses.end()) {
+            address = it->second;
+            return true;
+        }
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        return false;
+    }
+    std::memcpy(&address, result->ai_addr, sizeof(address));
+    freeaddrinfo(result);
+    std::lock_guard<std::mutex> lock(mutex);
+    addresses[key] = address;
+    return true;
+}
+
+void SCPIDriverPool::forget(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    addresses.erase(key);
+}
+
+bool SCPIDriverPool::open(Connection& conn, const sockaddr_in& address) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    setNonBlocking(fd);
+    setCloseOnExec(fd);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int rc = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    if (rc < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return false;
+    }
+
+    conn.fd = fd;
+    conn.connecting = rc < 0;
+    byFd[fd] = &conn;
+#ifdef __linux__
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.fd = fd;
+    epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev);
+#endif
+    return true;
+}
+
+void SCPIDriverPool::watch(Connection& conn) {
+#ifdef __linux__
+    if (conn.fd < 0) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    if (conn.connecting || conn.txOffset < conn.tx.size()) ev.events |= EPOLLOUT;
+    ev.data.fd = conn.fd;
+    epoll_ctl(pollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+#else
+    (void)conn;  // poll() interest is rebuilt every iteration
+#endif
+}
+
+// The head of inflight is the exchange whose reply is due next
+void SCPIDriverPool::startClock(Connection& conn, Clock::time_point now) {
+    if (!conn.inflight.empty()) {
+        conn.inflight.front().deadline = now + conn.inflight.front().timeout;
+    }
+}
+
+void SCPIDriverPool::failAll(Connection& conn, const std::string& why) {
+    if (conn.fd >= 0) {
+        byFd.erase(conn.fd);
+        close(conn.fd);  // also drops it from the epoll set
+        conn.fd = -1;
+    }
+    conn.connecting = false;
+    conn.tx.clear();
+    conn.txOffset = 0;
+    conn.rx.clear();
+    std::deque<Exchange> failed;
+    failed.swap(conn.inflight);
+    for (auto& exchange : failed) {
+        exchange.done(SCPIReply{false, why});
+    }
+}
+
+void SCPIDriverPool::flush(Connection& conn) {
+    while (conn.fd >= 0 && !conn.connecting && conn.txOffset < conn.tx.size()) {
+        ssize_t n = send(conn.fd, conn.tx.data() + conn.txOffset, conn.tx.size() - conn.txOffset, kSendFlags);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            failAll(conn, "send() failed");
+            return;
+        }
+        conn.txOffset += static_cast<size_t>(n);
+    }
+    if (conn.txOffset == conn.tx.size()) {
+        conn.tx.clear();
+        conn.txOffset = 0;
+    }
+}
+
+void SCPIDriverPool::receive(Connection& conn) {
+    const char* failure = nullptr;
+    for (;;) {
+        size_t used = conn.rx.size();
+        conn.rx.resize(used + kReadChunk);
+        ssize_t n = recv(conn.fd, &conn.rx[used], kReadChunk, 0);
+        if (n <= 0) {
+            conn.rx.resize(used);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            failure = n == 0 ? "Connection closed by instrument" : "recv() failed";
+            break;
+        }
+        conn.rx.resize(used + static_cast<size_t>(n));
+    }
+
+    size_t start = 0;
+    size_t newline;
+    bool replied = false;
+    while ((newline = conn.rx.find('\n', start)) != std::string::npos) {
+        size_t end = newline;
+        if (end > start && conn.rx[end - 1] == '\r') --end;
+        if (!conn.inflight.empty()) {
+            Exchange exchange = std::move(conn.inflight.front());
+            conn.inflight.pop_front();
+            exchange.done(SCPIReply{true, conn.rx.substr(start, end - start)});
+            replied = true;
+        }
+        start = newline + 1;
+    }
+    conn.rx.erase(0, start);
+    if (replied) {
+        startClock(conn, Clock::now());
+    }
+
+    // Replies that arrived before the close are delivered above; only the rest fail
+    if (failure != nullptr) {
+        failAll(conn, failure);
+    }
+}
+
+void SCPIDriverPool::takeSubmissions() {
+    std::vector<Submission> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(submissions);
+    }
+    for (auto& submission : batch) {
+        std::unique_ptr<Connection>& slot = connections[submission.key];
+        if (!slot) {
+            slot.reset(new Connection());
+            slot->host = submission.host;
+            slot->port = submission.port;
+        }
+        Connection& conn = *slot;
+        if (!submission.resolved) {
+            submission.exchange.done(SCPIReply{false, "Cannot resolve " + submission.host});
+            continue;
+        }
+        if (conn.fd < 0 && !open(conn, submission.address)) {
+            forget(submission.key);
+            submission.exchange.done(SCPIReply{false, "Cannot connect to " + submission.key});
+            continue;
+        }
+        conn.tx += submission.exchange.command;
+        if (conn.tx.empty() || conn.tx.back() != '\n') conn.tx += '\n';
+        conn.inflight.push_back(std::move(submission.exchange));
+        if (conn.inflight.size() == 1) {
+            startClock(conn, Clock::now());
+        }
+        flush(conn);
+        watch(conn);
+    }
+}
+
+void SCPIDriverPool::expire(Clock::time_point now) {
+    for (auto& entry : connections) {
+        Connection& conn = *entry.second;
+        // Replies come back in order, so once one is late the rest cannot be trusted
+        if (!conn.inflight.empty() && conn.inflight.front().deadline <= now) {
+            failAll(conn, "Timed out waiting for reply");
+        }
+    }
+}
+
+int SCPIDriverPool::nextTimeoutMs(Clock::time_point now) const {
+    bool any = false;
+    Clock::time_point next{};
+    for (const auto& entry : connections) {
+        const Connection& conn = *entry.second;
+        if (!conn.inflight.empty() && (!any || conn.inflight.front().deadline < next)) {
+            next = conn.inflight.front().deadline;
+            any = true;
+        }
+    }
+    if (!any) return -1;
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() + 1;
+    return static_cast<int>(std::max<long long>(0, ms));
+}
+
+void SCPIDriverPool::run() {
+    std::vector<std::pair<int, short>> ready;
+    for (;;) {
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = stopping;
+        }
+        takeSubmissions();
+        if (stop) break;
+
+        int timeout = nextTimeoutMs(Clock::now());
+        ready.clear();
+#ifdef __linux__
+        epoll_event events[64];
+        int n = epoll_wait(pollFd, events, 64, timeout);
+        for (int i = 0; i < n; ++i) {
+            short revents = 0;
+            if (events[i].events & EPOLLIN) revents |= POLLIN;
+            if (events[i].events & EPOLLOUT) revents |= POLLOUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) revents |= POLLERR;
+            int fd = events[i].data.fd;
+            ready.emplace_back(fd, revents);
+        }
+#else
+        std::vector<pollfd> fds;
+        fds.push_back(pollfd{wakeRead, POLLIN, 0});
+        for (const auto& entry : byFd) {
+            const Connection& conn = *entry.second;
+            short events = POLLIN;
+            if (conn.connecting || conn.txOffset < conn.tx.size()) events |= POLLOUT;
+            fds.push_back(pollfd{entry.first, events, 0});
+        }
+        int n = poll(fds.data(), fds.size(), timeout);
+        for (int i = 0; n > 0 && i < static_cast<int>(fds.size()); ++i) {
+            if (fds[i].revents) {
+                short revents = fds[i].revents;
+                if (revents & (POLLHUP | POLLNVAL)) revents |= POLLERR;
+                ready.emplace_back(fds[i].fd, revents);
+            }
+        }
+#endif
+
+        for (const auto& event : ready) {
+            if (event.first == wakeRead) {
+                char drain[64];
+                while (read(wakeRead, drain, sizeof(drain)) > 0) {
+                }
+                continue;
+            }
+            auto it = byFd.find(event.first);
+            if (it == byFd.end()) continue;  // closed earlier in this batch
+            Connection& conn = *it->second;
+
+            if (conn.connecting) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    forget(conn.host + ":" + std::to_string(conn.port));
+                    failAll(conn, "Cannot connect to " + conn.host + ":" + std::to_string(conn.port));
+                    continue;
+                }
+                if (!(event.second & (POLLOUT | POLLERR))) continue;
+                conn.connecting = false;
+            }
+            if (event.second & POLLIN) receive(conn);
+            if (conn.fd >= 0 && (event.second & POLLERR) && !(event.second & POLLIN)) {
+                failAll(conn, "Connection dropped");
+            }
+            if (conn.fd >= 0 && (event.second & POLLOUT)) flush(conn);
+            watch(conn);
+        }
+        expire(Clock::now());
+    }
+
+    for (auto& entry : connections) {
+        failAll(*entry.second, "Pool stopped");
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef SCPI_POOL_HPP
+#define SCPI_POOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <unordered_map>
+#include <vector>
+
+// Reply to one SCPI exchange. ok is false on connect failure, timeout or a
+// dropped connection, in which case reply holds the error text.
+struct SCPIReply {
+    bool ok;
+    std::string reply;
+};
+
+// Drives many instruments (host:port pairs) from one event-loop thread
+// (epoll on Linux, poll elsewhere; POSIX only). Each instrument gets one
+// persistent non-blocking connection; commands to it are pipelined and their
+// newline-framed replies matched in order, so hundreds of exchanges can be
+// outstanding without a thread per socket. Callbacks run on the loop thread
+// and must not block. Host names are resolved by the submitting thread, once
+// per host:port, so a slow DNS lookup never stalls the loop.
+class SCPIDriverPool {
+public:
+    using Callback = std::function<void(const SCPIReply&)>;
+
+    SCPIDriverPool();
+    ~SCPIDriverPool();
+
+    SCPIDriverPool(const SCPIDriverPool&) = delete;
+    SCPIDriverPool& operator=(const SCPIDriverPool&) = delete;
+
+    // Per-exchange timeout, applied to commands submitted afterwards. An
+    // exchange's clock starts when the reply before it arrives (or when it
+    // is written, if nothing is ahead of it), so deep pipelines to a slow
+    // instrument do not time out.
+    void setTimeout(int timeout_ms);
+
+    void sendCommand(const std::string& host, int port, const std::string& cmd, Callback done);
+    std::future<SCPIReply> sendCommand(const std::string& host, int port, const std::string& cmd);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Exchange {
+        std::string command;
+        Callback done;
+        std::chrono::milliseconds timeout;
+        Clock::time_point deadline;  // set when the exchange reaches the head of inflight
+    };
+
+    struct Submission {
+        std::string key;
+        std::string host;
+        int port;
+        bool resolved;
+        sockaddr_in address;
+        Exchange exchange;
+    };
+
+    struct Connection {
+        std::string host;
+        int port = 0;
+        int fd = -1;
+        bool connecting = false;
+        std::string tx;
+        std::size_t txOffset = 0;
+        std::string rx;
+        std::deque<Exchange> inflight;  // written (or queued in tx), awaiting replies in order
+    };
+
+    void run();
+    void takeSubmissions();
+    bool resolve(const std::string& key, const std::string& host, int port, sockaddr_in& address);
+    void forget(const std::string& key);
+    bool open(Connection& conn, const sockaddr_in& address);
+    void startClock(Connection& conn, Clock::time_point now);
+    void flush(Connection& conn);
+    void receive(Connection& conn);
+    void failAll(Connection& conn, const std::string& why);
+    void expire(Clock::time_point now);
+    int nextTimeoutMs(Clock::time_point now) const;
+    void watch(Connection& conn);
+
+    std::mutex mutex;
+    std::vector<Submission> submissions;
+    std::unordered_map<std::string, sockaddr_in> addresses;  // resolved host:port, dropped when a connect fails
+    int timeoutMs;
+    bool stopping;
+
+    // Loop thread only
+    std::unordered_map<std::string, std::unique_ptr<Connection>> connections;
+    std::unordered_map<int, Connection*> byFd;
+    int pollFd;     // epoll instance (Linux)
+    int wakeRead;   // self-pipe to interrupt the wait
+    int wakeWrite;
+    std::thread loop;
+};
+
+#endif
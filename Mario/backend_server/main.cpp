@@ -11,63 +11,24 @@
 
 #include <httplib.h>
 #include <json.hpp>   // nlohmann/json
-#include <iostream>
 #include <string>
+#include "scpi_commands.hpp"
+#include "../../controller/logger.hpp"
 
 using namespace httplib;
 using json = nlohmann::json;
 
-// Hardcoded SCPI paths
-json config = {
-    {"paths", {
-        { {"id", 1}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 1} },
-        { {"id", 2}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 2} },
-        { {"id", 3}, {"component_id", "switch1"}, {"address", 268436224}, {"gpio_value", 3} },
-        { {"id", 4}, {"component_id", "switch2"}, {"address", 268436480}, {"gpio_value", 4} }
-    }}
-};
-
-// Very basic SCPI command handler
-std::string sendCommand(const std::string &cmd) {
-    // Handle ":ROUTE:PATH n" or ":ROUTE:PATH? n"
-    if (cmd.rfind(":ROUTE:PATH", 0) == 0) {
-        try {
-            // Check if it’s a query
-            bool is_query = (cmd.find('?') != std::string::npos);
-
-            // Extract number part after ":ROUTE:PATH"
-            std::string num_str = cmd.substr(11);
-            // Remove '?' and trim spaces
-            num_str.erase(remove(num_str.begin(), num_str.end(), '?'), num_str.end());
-            num_str.erase(0, num_str.find_first_not_of(" \t"));
-            num_str.erase(num_str.find_last_not_of(" \t") + 1);
-
-            int requested_id = std::stoi(num_str);
-
-            // Look for a matching path in config
-            for (auto &path : config["paths"]) {
-                if (path["id"] == requested_id) {
-                    // ✅ Always return the whole JSON object
-                    return path.dump();
-                }
-            }
-            return R"({"error":"Path ID not found"})";
-        } catch (...) {
-            return R"({"error":"Invalid SCPI command format"})";
-        }
-    }
-
-    return R"({"error":"Unknown SCPI command"})";
-}
-
+// httplib also declares a Logger, hence the qualification
+::Logger& logger = ::Logger::instance();
 
 int main() {
     Server svr;
 
     // Endpoint: handle SCPI commands
     svr.Post("/scpi", [](const Request &req, Response &res) {
+        LatencyHistograms::Scope timing(scpiLatency, kScpiStageRequest);
         std::string command = req.body;
-        std::cout << "📩 Received SCPI command: " << command << std::endl;
+        logger.info("📩 Received SCPI command", {{"command", command}});
 
         std::string reply = sendCommand(command);
         res.set_content(reply, "text/plain");
@@ -93,6 +54,14 @@ int main() {
         res.set_content("{\"error\": \"Path not found\"}", "application/json");
     });
 
-    std::cout << "🚀 Server listening on http://localhost:8080 ..." << std::endl;
+    // Per-stage latency for Prometheus: p50/p99/p999, sum and count
+    svr.Get("/metrics", [](const Request &, Response &res) {
+        std::string out;
+        scpiLatency.write_prometheus(out, "mario_scpi_stage_seconds", "Time spent in each stage of a /scpi request.");
+        res.set_content(out, "text/plain; version=0.0.4");
+    });
+
+    logger.info("🚀 Server listening on http://localhost:8080 ...");
     svr.listen("localhost", 8080);
+    return 0;
 }
@@ -0,0 +1,136 @@
+// Drives include1/scpi_pool.cpp against real sockets.
+// First a built-in instrument on a loopback port that answers one command and
+// then closes, which the pool must report as a reply, not as a dropped
+// connection. Then every host:port given on the command line (for example
+// Ramiro/fake_fpga on 5025, or several of them on different ports) gets
+// PATH:SELECT 1..8 twice and STATE? pipelined, all chassis at once, from the
+// pool's single loop thread. At fake_fpga's 150 ms per PATH:SELECT that
+// pipeline takes longer than the default 1500 ms timeout, which must only
+// apply to each reply.
+// Build (Linux, from Mario/backend_server):
+//   g++ -std=c++17 scpi_pool_check.cpp include1/scpi_pool.cpp -Iinclude1 -pthread -o scpi_pool_check
+// Run:   python3 ../../Ramiro/fake_fpga/fpga.py 5025 &  ./scpi_pool_check 127.0.0.1:5025
+// Exit status is 1 if any exchange fails.
+
+#include "scpi_pool.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Listens on 127.0.0.1, answers the first line of the first client with
+// "OK" and closes the connection straight after
+class ReplyThenClose {
+public:
+    ReplyThenClose() : listenFd(socket(AF_INET, SOCK_STREAM, 0)), port(0) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listenFd, 1) != 0 || getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            return;
+        }
+        port = ntohs(addr.sin_port);
+        server = std::thread([this] {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) return;
+            char c;
+            while (recv(fd, &c, 1, 0) == 1 && c != '\n') {
+            }
+            ssize_t ignored = send(fd, "OK\n", 3, 0);
+            (void)ignored;
+            close(fd);
+        });
+    }
+
+    ~ReplyThenClose() {
+        if (server.joinable()) server.join();
+        if (listenFd >= 0) close(listenFd);
+    }
+
+    int listeningPort() const { return port; }
+
+private:
+    int listenFd;
+    int port;
+    std::thread server;
+};
+
+bool parseTarget(const std::string& text, std::string& host, int& port) {
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon == 0) return false;
+    host = text.substr(0, colon);
+    char* end = nullptr;
+    long value = std::strtol(text.c_str() + colon + 1, &end, 10);
+    if (*end != '\0' || value <= 0 || value > 65535) return false;
+    port = static_cast<int>(value);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int failures = 0;
+    SCPIDriverPool pool;
+
+    {
+        ReplyThenClose instrument;
+        if (instrument.listeningPort() == 0) {
+            std::cerr << "reply-then-close: cannot listen on loopback" << std::endl;
+            return 1;
+        }
+        SCPIReply reply = pool.sendCommand("127.0.0.1", instrument.listeningPort(), "*IDN?").get();
+        bool passed = reply.ok && reply.reply == "OK";
+        std::cout << "reply-then-close: " << (passed ? "ok" : "FAILED (" + reply.reply + ")") << std::endl;
+        failures += passed ? 0 : 1;
+    }
+
+    struct Pending {
+        std::string target;
+        std::string command;
+        std::future<SCPIReply> reply;
+    };
+    std::vector<Pending> pending;
+    for (int i = 1; i < argc; ++i) {
+        std::string host;
+        int port = 0;
+        if (!parseTarget(argv[i], host, port)) {
+            std::cerr << "Usage: " << argv[0] << " [host:port ...]" << std::endl;
+            return 2;
+        }
+        std::vector<std::string> commands;
+        for (int round = 0; round < 2; ++round) {
+            for (int path = 1; path <= 8; ++path) {
+                commands.push_back("PATH:SELECT " + std::to_string(path));
+            }
+        }
+        commands.push_back("STATE?");
+        for (const auto& command : commands) {
+            pending.push_back(Pending{argv[i], command, pool.sendCommand(host, port, command)});
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& exchange : pending) {
+        SCPIReply reply = exchange.reply.get();
+        bool passed = reply.ok && (exchange.command == "STATE?" ? reply.reply.rfind("{", 0) == 0 : reply.reply == "OK");
+        std::cout << exchange.target << " " << exchange.command << " -> " << reply.reply
+                  << (passed ? "" : "  FAILED") << std::endl;
+        failures += passed ? 0 : 1;
+    }
+    if (!pending.empty()) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << pending.size() << " exchanges in " << elapsed.count() << " ms" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
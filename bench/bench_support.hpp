@@ -0,0 +1,108 @@
+#ifndef BENCH_SUPPORT_HPP
+#define BENCH_SUPPORT_HPP
+
+// Timing and allocation counting shared by the microbenchmarks. The global
+// allocation functions are replaced here (all of new, new[], delete and
+// delete[], sized or not) so every heap allocation is counted, so include
+// this from exactly one translation unit of a bench: the one with main().
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace bench {
+
+// Relaxed atomic: the command core's scheduler and logger threads allocate too
+inline std::atomic<std::uint64_t> allocations{0};
+
+// Results are stored here so the optimizer keeps the work
+inline volatile std::size_t sink;
+
+struct Measurement {
+    double ns;           // per call, best round
+    double allocations;  // per call
+};
+
+// Doubles the iteration count until one round of op takes min_round
+template <typename Op>
+std::uint64_t calibrate(Op op, std::chrono::milliseconds min_round = std::chrono::milliseconds(50)) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t iterations = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        if (Clock::now() - start >= min_round || iterations >= (1ull << 30)) {
+            return iterations;
+        }
+        iterations *= 2;
+    }
+}
+
+// Best of 5 rounds, so scheduler noise stays out of the figure
+template <typename Op>
+Measurement best_of(std::uint64_t iterations, Op op) {
+    using Clock = std::chrono::steady_clock;
+    double best = 0;
+    std::uint64_t counted = 0;
+    for (int round = 0; round < 5; ++round) {
+        std::uint64_t before = allocations.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        auto elapsed = Clock::now() - start;
+        counted = allocations.load(std::memory_order_relaxed) - before;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return {best, static_cast<double>(counted) / static_cast<double>(iterations)};
+}
+
+[[gnu::noinline]] inline void* allocate(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Out of line, so GCC does not pair a new-expression with the free() here
+// and report -Wmismatched-new-delete
+[[gnu::noinline]] inline void release(void* p) noexcept {
+    std::free(p);
+}
+
+} // namespace bench
+
+void* operator new(std::size_t size) {
+    return bench::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return bench::allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    bench::release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    bench::release(p);
+}
+
+void operator delete[](void* p) noexcept {
+    bench::release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    bench::release(p);
+}
+
+#endif
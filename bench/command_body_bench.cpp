@@ -0,0 +1,81 @@
+// Allocations and ns per POST /command body: the nlohmann::json DOM the
+// handler used to build against controller/command_body.hpp, both pulling
+// out the scpi_command strings and nothing else. Heap allocations are
+// counted by bench/bench_support.hpp.
+// Build: g++ bench/command_body_bench.cpp controller/command_body.cpp -I. -I./include -std=c++17 -O2 -o command_body_bench
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "bench/bench_support.hpp"
+#include "controller/command_body.hpp"
+
+namespace {
+
+// What the handler did before: parse, look up, read the string(s)
+std::size_t dom_extract(const std::string& request) {
+    nlohmann::json body = nlohmann::json::parse(request);
+    if (!body.contains("scpi_command")) {
+        return 0;
+    }
+    const nlohmann::json& commands = body["scpi_command"];
+    if (commands.is_string()) {
+        return commands.get_ref<const std::string&>().size();
+    }
+    std::size_t total = 0;
+    for (const auto& message : commands) {
+        total += message.get_ref<const std::string&>().size();
+    }
+    return total;
+}
+
+std::size_t scan_extract(const std::string& request) {
+    command_body::Body body;
+    if (command_body::scan(request, body) != command_body::Error::None) {
+        return 0;
+    }
+    std::string scratch;
+    std::size_t total = 0;
+    command_body::for_each_string(body.command, scratch, [&](std::string_view message) {
+        total += message.size();
+    });
+    return total;
+}
+
+template <typename Extract>
+bench::Measurement measure(const std::string& request, Extract extract) {
+    auto op = [&] { bench::sink = extract(request); };
+    return bench::best_of(bench::calibrate(op), op);
+}
+
+} // namespace
+
+int main() {
+    struct Case {
+        const char* name;
+        std::string body;
+    };
+    const std::vector<Case> cases = {
+        {"single command", R"({"scpi_command": "PATH:SELECT 3"})"},
+        {"compound message", R"({"scpi_command": "PATH:SELECT 3;:SWITCH:SELECT SW1 2;:SWITCH:INFO? 1"})"},
+        {"batch array", R"({"scpi_command": ["PATH:SELECT 3", "SWITCH:SELECT SW1 2", "*OPC?"]})"},
+        {"extra fields", R"({"client": "rfiu-ui", "seq": 1842, "scpi_command": "SWITCH:SELECT SW2 1"})"},
+        {"escaped string", R"({"scpi_command": "SWITCH:SELECT SW1 2\n"})"},
+    };
+
+    for (const Case& c : cases) {
+        if (dom_extract(c.body) != scan_extract(c.body)) {
+            std::cerr << c.name << ": extractors disagree" << std::endl;
+            return 1;
+        }
+        bench::Measurement dom = measure(c.body, dom_extract);
+        bench::Measurement scan = measure(c.body, scan_extract);
+        std::cout << c.name << " (" << c.body.size() << " bytes)\n"
+                  << "  nlohmann DOM: " << dom.allocations << " allocations, " << dom.ns << " ns\n"
+                  << "  scanner:      " << scan.allocations << " allocations, " << scan.ns << " ns" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Microbenchmarks for the pieces on the command hot path, Google Benchmark
+// style: each case is run until its timing is stable and reports ns and
+// heap allocations per operation (bench/bench_support.hpp).
+//
+//   process_scpi_command/*  the real sfp_server command path against the
+//                           simulated register backend
+//   config_lookup/*         a path's writes from the paths.json DOM, as the
+//                           handler used to find them, against RouteTable
+//   request_parse/*         nlohmann::json::parse of a POST /command body,
+//                           against controller/command_body.hpp
+//   response/*              reply built as a DOM and dump()ed, against JsonWriter
+//   mario/*                 the Mario backend's sendCommand (:ROUTE:PATH)
+//
+// The functions measured are the ones shipped: controller/command_core.cpp
+// and Mario/backend_server/include1/scpi_commands.cpp are linked in.
+// Run from the repository root (paths.json, components_paths.json); an
+// optional argument keeps only the cases whose name contains it.
+//
+// Build: g++ bench/command_core_bench.cpp controller/*.cpp Mario/backend_server/include1/scpi_commands.cpp -I. -I./include -IMario/backend_server/include1 -std=c++17 -O2 -pthread -lz -o command_core_bench
+// Run:   ./command_core_bench [filter]
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "bench/bench_support.hpp"
+#include "controller/command_body.hpp"
+#include "controller/command_core.hpp"
+#include "Mario/backend_server/include1/scpi_commands.hpp"
+
+namespace {
+
+const char* filter = nullptr;
+
+template <typename Op>
+void run(const char* name, Op op) {
+    if (filter != nullptr && std::string(name).find(filter) == std::string::npos) {
+        return;
+    }
+    std::uint64_t iterations = bench::calibrate(op);
+    bench::Measurement result = bench::best_of(iterations, op);
+    std::cout << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(11) << result.ns << " ns" << std::setw(12) << iterations << std::setprecision(2)
+              << std::setw(12) << result.allocations << std::endl;
+}
+
+// How the /command handler found a path's writes before RouteTable
+std::size_t json_walk_lookup(const nlohmann::json& paths, int path_id) {
+    std::size_t total = 0;
+    for (const auto& path : paths) {
+        if (path["id"].get<int>() == path_id) {
+            total += path["address"].get<uint32_t>() + path["gpio_value"].get<uint8_t>();
+        }
+    }
+    return total;
+}
+
+std::size_t table_lookup(const RouteTable& routes, int path_id) {
+    std::size_t total = 0;
+    for (const PathEntry* entry = routes.path_begin(path_id); entry != routes.path_end(path_id); ++entry) {
+        total += entry->address + entry->gpio_value;
+    }
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    filter = argc > 1 ? argv[1] : nullptr;
+
+    // The command path logs every path change at info
+    logger.set_level(LogLevel::Warn);
+    std::string error;
+    axi_registers = RegisterMap::open_simulated("", 0x10000000, 0x10000, error);
+    if (!axi_registers) {
+        std::cerr << "Cannot map simulated registers: " << error << std::endl;
+        return 1;
+    }
+    publish_routes(RouteTable::load("paths.json", "components_paths.json"));
+    std::shared_ptr<const RouteTable> routes = current_routes();
+    if (!routes->paths_loaded()) {
+        std::cerr << "paths.json not found; run from the repository root" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(44) << "Benchmark" << std::right << std::setw(14) << "Time"
+              << std::setw(12) << "Iterations" << std::setw(12) << "allocs/op" << std::endl;
+    std::cout << std::string(82, '-') << std::endl;
+
+    // After the first call the relays are in place, so these measure the
+    // command path itself rather than the 150 ms relay settle time
+    const scpi::ParsedCommand path_select = scpi::parse("PATH:SELECT 1");
+    const scpi::ParsedCommand switch_select = scpi::parse("SWITCH:SELECT SW1 1");
+    process_scpi_command(path_select, *routes);
+    run("process_scpi_command/PATH:SELECT", [&] {
+        bench::sink = process_scpi_command(path_select, *routes).settled_at.time_since_epoch().count();
+    });
+    run("process_scpi_command/SWITCH:SELECT", [&] {
+        bench::sink = process_scpi_command(switch_select, *routes).settled_at.time_since_epoch().count();
+    });
+    run("process_scpi_command/parse+PATH:SELECT", [&] {
+        bench::sink = process_scpi_command(scpi::parse("PATH:SELECT 1"), *routes).settled_at.time_since_epoch().count();
+    });
+    run("process_scpi_command/reply PATH:SELECT", [&] {
+        auto pending = SwitchScheduler::Clock::now();
+        JsonWriter json(json_buffer);
+        write_scpi_reply(json, path_select, *routes, pending);
+        bench::sink = json_buffer.size();
+    });
+
+    const nlohmann::json& paths = routes->paths_json();
+    run("config_lookup/json_walk", [&] { bench::sink = json_walk_lookup(paths, 3); });
+    run("config_lookup/route_table", [&] { bench::sink = table_lookup(*routes, 3); });
+
+    const std::string body = R"({"scpi_command": "PATH:SELECT 3"})";
+    run("request_parse/nlohmann_parse", [&] {
+        nlohmann::json request = nlohmann::json::parse(body);
+        bench::sink = request["scpi_command"].get_ref<const std::string&>().size();
+    });
+    run("request_parse/command_body_scan", [&] {
+        command_body::Body scanned;
+        command_body::scan(body, scanned);
+        bench::sink = scanned.command.size();
+    });
+
+    run("response/nlohmann_dump", [&] {
+        nlohmann::json response;
+        response["status"] = "OK";
+        response["message"] = "Command processed successfully";
+        response["current_path"] = 3;
+        bench::sink = response.dump().size();
+    });
+    run("response/json_writer", [&] {
+        JsonWriter json(json_buffer);
+        json.begin_object();
+        json.key(kStatusKey).value("OK");
+        json.key(kMessageKey).value("Command processed successfully");
+        json.key(kCurrentPathKey).value(3);
+        json.end_object();
+        bench::sink = json_buffer.size();
+    });
+
+    const std::string route_path = ":ROUTE:PATH 3";
+    const std::string route_unknown = ":ROUT:PATH? 99";
+    run("mario/sendCommand :ROUTE:PATH", [&] { bench::sink = sendCommand(route_path).size(); });
+    run("mario/sendCommand unknown path", [&] { bench::sink = sendCommand(route_unknown).size(); });
+    return 0;
+}
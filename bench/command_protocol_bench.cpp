@@ -0,0 +1,168 @@
+// Commands/sec through a running sfp_server: POST /command (JSON over HTTP,
+// keep-alive) against the binary frames of controller/binary_protocol.hpp,
+// one at a time and pipelined, over TCP and optionally a Unix socket.
+// Every command is PATH:SELECT 1, so after the first one the shadow
+// registers skip the relay writes and only the protocol cost is measured.
+// Build: g++ bench/command_protocol_bench.cpp -I. -I./include -std=c++17 -O2 -pthread -o command_protocol_bench
+// Run:   SFP_BINARY_SOCKET=/tmp/sfp.sock ./sfp_server &
+//        ./command_protocol_bench [host] [http_port] [binary_port] [unix_socket]
+
+#include <httplib.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "controller/binary_protocol.hpp"
+
+namespace {
+
+constexpr int kCommands = 20000;
+constexpr int kWindow = 256;  // frames in flight when pipelining
+
+double per_second(int commands, std::chrono::steady_clock::time_point since) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    return commands / seconds;
+}
+
+double run_http(const std::string& host, int port) {
+    httplib::Client client(host, port);
+    client.set_keep_alive(true);
+    client.set_tcp_nodelay(true);
+    const std::string body = R"({"scpi_command": "PATH:SELECT 1"})";
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCommands; ++i) {
+        auto res = client.Post("/command", body, "application/json");
+        if (!res || res->status != 200) {
+            std::cerr << "HTTP request failed\n";
+            return 0;
+        }
+    }
+    return per_second(kCommands, start);
+}
+
+int connect_tcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        return -1;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    int one = 1;
+    if (fd >= 0) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+int connect_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+bool read_exact(int fd, unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = recv(fd, data, size, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// window = 1 is strict request/reply; larger windows pipeline
+double run_binary(int fd, int window) {
+    using binproto::kFrameSize;
+    std::vector<unsigned char> out(static_cast<size_t>(window) * kFrameSize);
+    std::vector<unsigned char> in(out.size());
+    binproto::Request request{binproto::Opcode::PathSelect, 0, 1, 0, 0};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int sent = 0; sent < kCommands; sent += window) {
+        int batch = std::min(window, kCommands - sent);
+        for (int i = 0; i < batch; ++i) {
+            request.tag = static_cast<uint16_t>(sent + i);
+            binproto::encode_request(request, &out[static_cast<size_t>(i) * kFrameSize]);
+        }
+        size_t bytes = static_cast<size_t>(batch) * kFrameSize;
+        if (send(fd, out.data(), bytes, 0) != static_cast<ssize_t>(bytes) || !read_exact(fd, in.data(), bytes)) {
+            std::cerr << "Binary exchange failed\n";
+            return 0;
+        }
+        binproto::Reply last = binproto::decode_reply(&in[bytes - kFrameSize]);
+        if (last.status != binproto::Status::Ok || last.tag != static_cast<uint16_t>(sent + batch - 1)) {
+            std::cerr << "Unexpected binary reply\n";
+            return 0;
+        }
+    }
+    return per_second(kCommands, start);
+}
+
+void report(const char* name, double rate, double baseline) {
+    std::cout << "  " << name << ": " << static_cast<long>(rate) << " commands/s";
+    if (baseline > 0 && rate > 0) {
+        std::cout << " (" << rate / baseline << "x HTTP)";
+    }
+    std::cout << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+    int http_port = argc > 2 ? std::atoi(argv[2]) : 8080;
+    int binary_port = argc > 3 ? std::atoi(argv[3]) : 5030;
+    std::string unix_socket = argc > 4 ? argv[4] : "";
+
+    std::cout << kCommands << " x PATH:SELECT 1" << std::endl;
+    double http = run_http(host, http_port);
+    report("POST /command (JSON, keep-alive)", http, 0);
+
+    int fd = connect_tcp(host, binary_port);
+    if (fd < 0) {
+        std::cerr << "Cannot connect to binary port " << binary_port << "\n";
+        return 1;
+    }
+    report("binary TCP, one at a time", run_binary(fd, 1), http);
+    report("binary TCP, pipelined", run_binary(fd, kWindow), http);
+    close(fd);
+
+    if (!unix_socket.empty()) {
+        fd = connect_unix(unix_socket);
+        if (fd < 0) {
+            std::cerr << "Cannot connect to " << unix_socket << "\n";
+            return 1;
+        }
+        report("binary Unix socket, one at a time", run_binary(fd, 1), http);
+        report("binary Unix socket, pipelined", run_binary(fd, kWindow), http);
+        close(fd);
+    }
+    return 0;
+}
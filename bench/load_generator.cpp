@@ -0,0 +1,387 @@
+// Load generator for a running sfp_server: POST /command, GET /status and
+// GET /config over keep-alive connections, one httplib::Client per worker
+// thread, with a weighted command mix.
+//
+//   closed loop: every connection sends its next request as soon as the
+//                previous reply is in (measures peak throughput)
+//   open loop:   requests are due at a fixed total --rate; latency counts
+//                from the moment a request was due, so a server that falls
+//                behind shows its queueing delay instead of hiding it
+//
+// Mix weights: path (PATH:SELECT 1..4), switch (SWITCH:SELECT SW1 1..3),
+// info (SWITCH:INFO? 1), status and config, e.g. --mix path=6,info=2,status=2.
+// Throughput and latency percentiles go to stdout, and to a JSON results file
+// with --out for regression tracking.
+//
+// Build: g++ bench/load_generator.cpp -I. -I./include -std=c++17 -O2 -pthread -o load_generator
+// Run:   ./sfp_server &    (SFP_REGISTERS defaults to the simulated backend)
+//        ./load_generator --connections 8 --seconds 10 --out results.json
+//        ./load_generator --mode open --rate 5000 --mix path=1,status=1
+
+#include <httplib.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Kind { kPathSelect, kSwitchSelect, kSwitchInfo, kStatus, kConfig, kKinds };
+const char* const kKindNames[kKinds] = {"path", "switch", "info", "status", "config"};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 4;
+    double seconds = 5;
+    double warmup = 1;
+    bool open_loop = false;
+    double rate = 1000;  // requests/s over all connections, open loop only
+    int weights[kKinds] = {6, 2, 1, 1, 0};
+    std::string out;
+};
+
+constexpr long kMaxWeight = 1000000;  // keeps the summed weights well inside an int
+
+// Whole number in [min, max]; unlike atoi, "abc" and "8x" are errors rather than 0 and 8
+bool parse_int(const char* text, long min, long max, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < min || parsed > max) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Finite number, strictly above min when exclusive
+bool parse_double(const char* text, double min, bool exclusive, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno != 0 || !std::isfinite(parsed) || parsed < min ||
+        (exclusive && parsed == min)) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parse_mix(const std::string& mix, int (&weights)[kKinds]) {
+    std::fill(std::begin(weights), std::end(weights), 0);
+    std::stringstream items(mix);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string name = item.substr(0, equals);
+        auto found = std::find_if(std::begin(kKindNames), std::end(kKindNames),
+                                  [&](const char* kind) { return name == kind; });
+        if (found == std::end(kKindNames)) {
+            return false;
+        }
+        if (!parse_int(item.c_str() + equals + 1, 0, kMaxWeight, weights[found - std::begin(kKindNames)])) {
+            return false;
+        }
+    }
+    return std::any_of(std::begin(weights), std::end(weights), [](int weight) { return weight > 0; });
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--host" && has_value) {
+            options.host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            if (!parse_int(argv[++i], 1, 65535, options.port)) {
+                std::cerr << "--port is 1 to 65535" << std::endl;
+                return false;
+            }
+        } else if (arg == "--connections" && has_value) {
+            if (!parse_int(argv[++i], 1, 4096, options.connections)) {
+                std::cerr << "--connections is 1 to 4096" << std::endl;
+                return false;
+            }
+        } else if (arg == "--seconds" && has_value) {
+            if (!parse_double(argv[++i], 0, true, options.seconds)) {
+                std::cerr << "--seconds must be a positive number" << std::endl;
+                return false;
+            }
+        } else if (arg == "--warmup" && has_value) {
+            if (!parse_double(argv[++i], 0, false, options.warmup)) {
+                std::cerr << "--warmup must be a number of seconds, 0 or more" << std::endl;
+                return false;
+            }
+        } else if (arg == "--mode" && has_value) {
+            std::string mode = argv[++i];
+            if (mode != "open" && mode != "closed") {
+                std::cerr << "--mode is open or closed" << std::endl;
+                return false;
+            }
+            options.open_loop = mode == "open";
+        } else if (arg == "--rate" && has_value) {
+            if (!parse_double(argv[++i], 0, true, options.rate)) {
+                std::cerr << "--rate must be a positive number of requests/s" << std::endl;
+                return false;
+            }
+        } else if (arg == "--mix" && has_value) {
+            if (!parse_mix(argv[++i], options.weights)) {
+                std::cerr << "Bad --mix, use e.g. path=6,switch=2,info=1,status=1,config=0" << std::endl;
+                return false;
+            }
+        } else if (arg == "--out" && has_value) {
+            options.out = argv[++i];
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Per worker, merged once the run is over
+struct Results {
+    std::vector<double> latency_us[kKinds];
+    std::uint64_t errors[kKinds] = {};
+};
+
+// xorshift64: cheap and good enough to pick from the mix
+std::uint64_t next_random(std::uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+Kind pick(const Options& options, int total_weight, std::uint64_t& random) {
+    int ticket = static_cast<int>(next_random(random) % static_cast<std::uint64_t>(total_weight));
+    for (int kind = 0; kind < kKinds; ++kind) {
+        ticket -= options.weights[kind];
+        if (ticket < 0) {
+            return static_cast<Kind>(kind);
+        }
+    }
+    return kPathSelect;
+}
+
+bool send(httplib::Client& client, Kind kind, std::uint64_t& random) {
+    httplib::Result res;
+    switch (kind) {
+    case kPathSelect:
+        res = client.Post("/command", "{\"scpi_command\":\"PATH:SELECT " + std::to_string(1 + next_random(random) % 4) + "\"}",
+                          "application/json");
+        break;
+    case kSwitchSelect:
+        res = client.Post("/command", "{\"scpi_command\":\"SWITCH:SELECT SW1 " + std::to_string(1 + next_random(random) % 3) + "\"}",
+                          "application/json");
+        break;
+    case kSwitchInfo:
+        res = client.Post("/command", "{\"scpi_command\":\"SWITCH:INFO? 1\"}", "application/json");
+        break;
+    case kStatus:
+        res = client.Get("/status");
+        break;
+    case kConfig:
+        res = client.Get("/config");
+        break;
+    default:
+        return false;
+    }
+    return res && res->status == 200;
+}
+
+void worker(const Options& options, int index, Clock::time_point start, Clock::time_point measure_from,
+            Clock::time_point end, Results& results) {
+    httplib::Client client(options.host, options.port);
+    client.set_keep_alive(true);
+    client.set_tcp_nodelay(true);
+    client.set_connection_timeout(std::chrono::seconds(2));
+    client.set_read_timeout(std::chrono::seconds(5));
+
+    int total_weight = 0;
+    for (int weight : options.weights) {
+        total_weight += weight;
+    }
+    std::uint64_t random = 0x9e3779b97f4a7c15ull * static_cast<std::uint64_t>(index + 1);
+
+    // Open loop: this connection's share of the rate, staggered against the others
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(options.connections / std::max(options.rate, 1e-9)));
+    Clock::time_point due = start + interval * index / options.connections;
+
+    for (;;) {
+        Clock::time_point sent;
+        if (options.open_loop) {
+            if (due >= end) {
+                break;
+            }
+            std::this_thread::sleep_until(due);
+            sent = due;  // a late start counts against the server, not the schedule
+            due += interval;
+        } else {
+            sent = Clock::now();
+            if (sent >= end) {
+                break;
+            }
+        }
+        Kind kind = pick(options, total_weight, random);
+        bool ok = send(client, kind, random);
+        Clock::time_point done = Clock::now();
+        if (sent < measure_from) {
+            continue;  // warmup
+        }
+        if (!ok) {
+            ++results.errors[kind];
+            continue;
+        }
+        results.latency_us[kind].push_back(std::chrono::duration<double, std::micro>(done - sent).count());
+    }
+}
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100 * static_cast<double>(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+nlohmann::json distribution(std::vector<double>& samples, std::uint64_t errors, double seconds) {
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    nlohmann::json stats;
+    stats["requests"] = samples.size();
+    stats["errors"] = errors;
+    stats["throughput_rps"] = static_cast<double>(samples.size()) / seconds;
+    stats["latency_us"] = {
+        {"mean", samples.empty() ? 0 : sum / static_cast<double>(samples.size())},
+        {"min", samples.empty() ? 0 : samples.front()},
+        {"p50", percentile(samples, 50)},
+        {"p90", percentile(samples, 90)},
+        {"p99", percentile(samples, 99)},
+        {"p999", percentile(samples, 99.9)},
+        {"max", samples.empty() ? 0 : samples.back()},
+    };
+    return stats;
+}
+
+void print_row(const std::string& name, const nlohmann::json& stats) {
+    const nlohmann::json& latency = stats["latency_us"];
+    std::cout << std::left << std::setw(8) << name << std::right << std::setw(10) << stats["requests"].get<std::uint64_t>()
+              << std::setw(8) << stats["errors"].get<std::uint64_t>() << std::fixed << std::setprecision(0)
+              << std::setw(11) << stats["throughput_rps"].get<double>() << std::setprecision(1)
+              << std::setw(9) << latency["p50"].get<double>() << std::setw(9) << latency["p90"].get<double>()
+              << std::setw(9) << latency["p99"].get<double>() << std::setw(10) << latency["p999"].get<double>()
+              << std::setw(10) << latency["max"].get<double>() << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+
+    {
+        httplib::Client probe(options.host, options.port);
+        probe.set_connection_timeout(std::chrono::seconds(2));
+        if (!probe.Get("/status")) {
+            std::cerr << "No sfp_server at " << options.host << ":" << options.port << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << (options.open_loop ? "open loop at " + std::to_string(static_cast<long>(options.rate)) + " req/s"
+                                    : std::string("closed loop"))
+              << ", " << options.connections << " connections, " << options.warmup << " s warmup + "
+              << options.seconds << " s" << std::endl;
+
+    std::vector<Results> results(static_cast<std::size_t>(options.connections));
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    auto measure_from = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    auto end = measure_from + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+    for (int i = 0; i < options.connections; ++i) {
+        workers.emplace_back(worker, std::cref(options), i, start, measure_from, end,
+                             std::ref(results[static_cast<std::size_t>(i)]));
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    // Requests still in flight at the deadline finish late; count the time they took
+    double seconds = std::max(options.seconds, std::chrono::duration<double>(Clock::now() - measure_from).count());
+
+    std::vector<double> all;
+    std::uint64_t all_errors = 0;
+    nlohmann::json by_kind = nlohmann::json::object();
+    for (int kind = 0; kind < kKinds; ++kind) {
+        std::vector<double> samples;
+        std::uint64_t errors = 0;
+        for (Results& worker_results : results) {
+            samples.insert(samples.end(), worker_results.latency_us[kind].begin(), worker_results.latency_us[kind].end());
+            errors += worker_results.errors[kind];
+        }
+        if (options.weights[kind] == 0) {
+            continue;
+        }
+        all.insert(all.end(), samples.begin(), samples.end());
+        all_errors += errors;
+        by_kind[kKindNames[kind]] = distribution(samples, errors, seconds);
+    }
+    nlohmann::json total = distribution(all, all_errors, seconds);
+
+    std::cout << std::left << std::setw(8) << "kind" << std::right << std::setw(10) << "requests" << std::setw(8)
+              << "errors" << std::setw(11) << "req/s" << std::setw(9) << "p50 us" << std::setw(9) << "p90 us"
+              << std::setw(9) << "p99 us" << std::setw(10) << "p999 us" << std::setw(10) << "max us" << "\n";
+    for (auto& [name, stats] : by_kind.items()) {
+        print_row(name, stats);
+    }
+    print_row("total", total);
+    std::cout << std::flush;
+
+    if (!options.out.empty()) {
+        nlohmann::json report;
+        report["target"] = options.host + ":" + std::to_string(options.port);
+        report["mode"] = options.open_loop ? "open" : "closed";
+        report["connections"] = options.connections;
+        report["seconds"] = seconds;
+        report["warmup_seconds"] = options.warmup;
+        if (options.open_loop) {
+            report["target_rate_rps"] = options.rate;
+        }
+        for (int kind = 0; kind < kKinds; ++kind) {
+            report["mix"][kKindNames[kind]] = options.weights[kind];
+        }
+        report["total"] = total;
+        report["by_kind"] = by_kind;
+        std::ofstream file(options.out);
+        if (!(file << report.dump(2) << "\n")) {
+            std::cerr << "Cannot write " << options.out << std::endl;
+            return 1;
+        }
+        std::cout << "Results written to " << options.out << std::endl;
+    }
+    return all_errors == 0 ? 0 : 2;
+}
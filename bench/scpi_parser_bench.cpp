@@ -0,0 +1,107 @@
+// Microbenchmark for controller/scpi_parser.hpp: ns per parsed command,
+// against the rfind + std::stoi prefix chain it replaced.
+// Build: g++ bench/scpi_parser_bench.cpp -I. -std=c++17 -O2 -o scpi_parser_bench
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "controller/scpi_parser.hpp"
+
+namespace {
+
+volatile std::uint64_t sink;
+
+// The dispatch sfp_server.cpp used before the registry
+int legacy_parse(const std::string& scpi_cmd) {
+    try {
+        if (scpi_cmd.rfind("PATH:SELECT ", 0) == 0) {
+            return std::stoi(scpi_cmd.substr(12));
+        }
+        if (scpi_cmd.rfind("SWITCH:SELECT ", 0) == 0) {
+            std::string params = scpi_cmd.substr(14);
+            return std::stoi(params.substr(params.find(' ') + 1));
+        }
+        if (scpi_cmd.rfind("SWITCH:INFO? ", 0) == 0) {
+            return std::stoi(scpi_cmd.substr(13));
+        }
+    } catch (...) {
+    }
+    return -1;
+}
+
+int registry_parse(const std::string& scpi_cmd) {
+    scpi::ParsedCommand cmd = scpi::parse(scpi_cmd);
+    std::string_view args = cmd.args;
+    int value = -1;
+    switch (cmd.command) {
+    case scpi::Command::PathSelect:
+    case scpi::Command::SwitchInfo:
+        scpi::parse_number(scpi::next_argument(args), value);
+        break;
+    case scpi::Command::SwitchSelect:
+        scpi::next_argument(args);
+        scpi::parse_number(scpi::next_argument(args), value);
+        break;
+    default:
+        break;
+    }
+    return value;
+}
+
+// Best of several rounds, to keep scheduler noise out of the figure
+template <typename Parse>
+double ns_per_command(const std::vector<std::string>& commands, Parse parse) {
+    const int rounds = 7;
+    const int iterations = 1000000;
+    double best = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::uint64_t total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            total += static_cast<std::uint64_t>(parse(commands[i % commands.size()]));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        sink = total;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    // Upper-case long forms only, so both parsers accept every command
+    const std::vector<std::string> commands = {
+        "PATH:SELECT 3",
+        "SWITCH:SELECT SW1 2",
+        "SWITCH:INFO? 2",
+        "PATH:SELECT 250",
+        "UNKNOWN:COMMAND 1",
+    };
+
+    std::cout << "legacy prefix chain: " << ns_per_command(commands, legacy_parse) << " ns/command" << std::endl;
+    std::cout << "command registry:    " << ns_per_command(commands, registry_parse) << " ns/command" << std::endl;
+
+    const std::vector<std::string> mixed_forms = {
+        ":rout:path? 3",
+        "Path:Sel 4",
+        "swit:sel SW2,1",
+        "switch:info? 1",
+    };
+    std::cout << "registry, short/mixed-case forms: " << ns_per_command(mixed_forms, registry_parse)
+              << " ns/command" << std::endl;
+
+    // Bad arguments: std::stoi reports these by throwing
+    const std::vector<std::string> malformed = {
+        "PATH:SELECT abc",
+        "SWITCH:INFO? x",
+    };
+    std::cout << "legacy, malformed arguments:   " << ns_per_command(malformed, legacy_parse) << " ns/command" << std::endl;
+    std::cout << "registry, malformed arguments: " << ns_per_command(malformed, registry_parse) << " ns/command" << std::endl;
+    return 0;
+}
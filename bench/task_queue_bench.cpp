@@ -0,0 +1,83 @@
+// httplib::ThreadPool against controller/ring_task_queue.hpp, the two
+// task queues sfp_server can run its HTTP workers on (--http-queue).
+// One producer thread enqueues bursts of short tasks, as httplib's accept
+// loop does under a burst of /status and /command requests; each task spins
+// for about as long as a /status handler. Reported per worker count: tasks/s
+// and the mean time from enqueue() to the task starting.
+// Build: g++ bench/task_queue_bench.cpp controller/ring_task_queue.cpp -I. -I./include -std=c++17 -O2 -pthread -o task_queue_bench
+// Run:   ./task_queue_bench [max_workers, default 64]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "controller/ring_task_queue.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kBursts = 400;
+constexpr int kBurstSize = 64;
+constexpr auto kTaskWork = std::chrono::microseconds(2);
+
+struct Result {
+    double tasks_per_second;
+    double mean_wait_us;
+};
+
+template <typename MakeQueue>
+Result measure(MakeQueue make_queue) {
+    std::unique_ptr<httplib::TaskQueue> queue(make_queue());
+    std::atomic<int> done(0);
+    std::atomic<std::int64_t> wait_ns(0);
+
+    auto start = Clock::now();
+    for (int burst = 0; burst < kBursts; ++burst) {
+        int target = (burst + 1) * kBurstSize;
+        for (int i = 0; i < kBurstSize; ++i) {
+            auto enqueued = Clock::now();
+            queue->enqueue([&, enqueued] {
+                auto started = Clock::now();
+                wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(started - enqueued).count(),
+                                  std::memory_order_relaxed);
+                while (Clock::now() - started < kTaskWork) {
+                }
+                done.fetch_add(1, std::memory_order_release);
+            });
+        }
+        // Next burst once this one has drained, like clients waiting for replies
+        while (done.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    queue->shutdown();
+
+    int tasks = kBursts * kBurstSize;
+    return {tasks / seconds, static_cast<double>(wait_ns.load()) / tasks / 1000};
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int max_workers = argc > 1 ? std::atoi(argv[1]) : 64;
+    std::cout << kBursts << " bursts of " << kBurstSize << " tasks, "
+              << std::chrono::duration<double, std::micro>(kTaskWork).count() << " us each, "
+              << std::thread::hardware_concurrency() << " cores\n";
+    std::cout << std::setw(8) << "workers" << std::setw(16) << "pool tasks/s" << std::setw(16) << "ring tasks/s"
+              << std::setw(14) << "pool wait us" << std::setw(15) << "ring wait us" << std::endl;
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+        std::size_t n = static_cast<std::size_t>(workers);
+        Result pool = measure([n] { return new httplib::ThreadPool(n); });
+        Result ring = measure([n] { return new RingTaskQueue(n); });
+        std::cout << std::fixed << std::setprecision(0) << std::setw(8) << workers << std::setw(16)
+                  << pool.tasks_per_second << std::setw(16) << ring.tasks_per_second << std::setprecision(1)
+                  << std::setw(14) << pool.mean_wait_us << std::setw(15) << ring.mean_wait_us << std::endl;
+    }
+    return 0;
+}
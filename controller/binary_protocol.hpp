@@ -0,0 +1,104 @@
+#ifndef BINARY_PROTOCOL_HPP
+#define BINARY_PROTOCOL_HPP
+
+// Fixed-size binary command frames for automated sweeps, served by
+// BinaryServer next to POST /command. Every request and every reply is
+// exactly 8 bytes, little endian, so a client can pipeline frames and
+// match replies by position (or by the echoed tag).
+//
+//   request                         reply
+//   0  u8  opcode                   0  u8  opcode (echoed)
+//   1  u8  switch (1 = SW1 ...)     1  u8  status
+//   2  u16 path id                  2  i16 current path, -1 if none
+//   4  u8  gpio value               4  u16 ms until the issued writes settle
+//   5  u8  reserved, 0              6  u16 tag (echoed)
+//   6  u16 tag
+
+#include <cstddef>
+#include <cstdint>
+
+namespace binproto {
+
+constexpr std::size_t kFrameSize = 8;
+
+enum class Opcode : std::uint8_t {
+    PathSelect = 1,    // PATH:SELECT <path id>
+    SwitchSelect = 2,  // SWITCH:SELECT SW<switch> <gpio value>
+    Complete = 3,      // *OPC?: replies once this connection's writes have settled
+    Status = 4,        // current path only
+};
+
+enum class Status : std::uint8_t {
+    Ok = 0,
+    BadOpcode = 1,
+    InvalidArgument = 2,
+    NotFound = 3,
+    NoPathSelected = 4,
+    ConfigMissing = 5,
+};
+
+struct Request {
+    Opcode opcode;
+    std::uint8_t switch_number;
+    std::uint16_t path_id;
+    std::uint8_t gpio_value;
+    std::uint16_t tag;
+};
+
+struct Reply {
+    Opcode opcode;
+    Status status;
+    std::int16_t current_path;
+    std::uint16_t settle_ms;
+    std::uint16_t tag;
+};
+
+inline std::uint16_t load_u16(const unsigned char* p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline void store_u16(unsigned char* p, std::uint16_t value) {
+    p[0] = static_cast<unsigned char>(value & 0xff);
+    p[1] = static_cast<unsigned char>(value >> 8);
+}
+
+inline Request decode_request(const unsigned char* frame) {
+    Request request;
+    request.opcode = static_cast<Opcode>(frame[0]);
+    request.switch_number = frame[1];
+    request.path_id = load_u16(frame + 2);
+    request.gpio_value = frame[4];
+    request.tag = load_u16(frame + 6);
+    return request;
+}
+
+inline void encode_request(const Request& request, unsigned char* frame) {
+    frame[0] = static_cast<unsigned char>(request.opcode);
+    frame[1] = request.switch_number;
+    store_u16(frame + 2, request.path_id);
+    frame[4] = request.gpio_value;
+    frame[5] = 0;
+    store_u16(frame + 6, request.tag);
+}
+
+inline Reply decode_reply(const unsigned char* frame) {
+    Reply reply;
+    reply.opcode = static_cast<Opcode>(frame[0]);
+    reply.status = static_cast<Status>(frame[1]);
+    reply.current_path = static_cast<std::int16_t>(load_u16(frame + 2));
+    reply.settle_ms = load_u16(frame + 4);
+    reply.tag = load_u16(frame + 6);
+    return reply;
+}
+
+inline void encode_reply(const Reply& reply, unsigned char* frame) {
+    frame[0] = static_cast<unsigned char>(reply.opcode);
+    frame[1] = static_cast<unsigned char>(reply.status);
+    store_u16(frame + 2, static_cast<std::uint16_t>(reply.current_path));
+    store_u16(frame + 4, reply.settle_ms);
+    store_u16(frame + 6, reply.tag);
+}
+
+} // namespace binproto
+
+#endif
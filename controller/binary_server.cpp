@@ -0,0 +1,229 @@
+#include "binary_server.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Frames handled per read; replies for them go out in one send
+constexpr std::size_t kBatchFrames = 512;
+
+} // namespace
+
+BinaryServer::BinaryServer(Handler handler) : handler_(std::move(handler)), running_(true) {}
+
+BinaryServer::~BinaryServer() {
+    stop();
+}
+
+#ifdef _WIN32
+
+bool BinaryServer::listen_tcp(const std::string&, int) {
+    Logger::instance().warn("Binary command protocol is not available on Windows");
+    return false;
+}
+
+bool BinaryServer::listen_unix(const std::string&) {
+    Logger::instance().warn("Binary command protocol is not available on Windows");
+    return false;
+}
+
+bool BinaryServer::add_listener(int) {
+    return false;
+}
+
+void BinaryServer::accept_loop(int) {}
+
+void BinaryServer::serve(int) {}
+
+void BinaryServer::stop() {}
+
+#else
+
+bool BinaryServer::listen_tcp(const std::string& host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        Logger::instance().error("Binary server: cannot resolve host", {{"host", host}});
+        return false;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    int one = 1;
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (fd < 0 || bind(fd, result->ai_addr, result->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+        Logger::instance().error("Binary server: cannot listen", {{"host", host}, {"port", port},
+                                                                  {"error", std::strerror(errno)}});
+        if (fd >= 0) {
+            close(fd);
+        }
+        freeaddrinfo(result);
+        return false;
+    }
+    freeaddrinfo(result);
+    Logger::instance().info("Binary command protocol listening", {{"host", host}, {"port", port}});
+    return add_listener(fd);
+}
+
+bool BinaryServer::listen_unix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        Logger::instance().error("Binary server: socket path too long", {{"path", path}});
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());  // stale socket from a previous run
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        Logger::instance().error("Binary server: cannot listen", {{"path", path}, {"error", std::strerror(errno)}});
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    unix_path_ = path;
+    Logger::instance().info("Binary command protocol listening", {{"path", path}});
+    return add_listener(fd);
+}
+
+bool BinaryServer::add_listener(int fd) {
+    listeners_.push_back(fd);
+    acceptors_.emplace_back(&BinaryServer::accept_loop, this, fd);
+    return true;
+}
+
+void BinaryServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    // shutdown() wakes the blocked accept() and recv() calls
+    for (int fd : listeners_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& acceptor : acceptors_) {
+        acceptor.join();
+    }
+    for (int fd : listeners_) {
+        close(fd);
+    }
+    listeners_.clear();
+    acceptors_.clear();
+    if (!unix_path_.empty()) {
+        unlink(unix_path_.c_str());
+    }
+
+    std::unique_lock<std::mutex> lock(clients_mutex_);
+    for (int fd : clients_) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    clients_done_.wait(lock, [this] { return clients_.empty(); });
+}
+
+void BinaryServer::accept_loop(int listen_fd) {
+    while (running_) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // fails harmlessly on Unix sockets
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex_);
+            if (!running_) {
+                close(fd);
+                break;
+            }
+            clients_.insert(fd);
+        }
+        std::thread(&BinaryServer::serve, this, fd).detach();
+    }
+}
+
+void BinaryServer::serve(int fd) {
+    using binproto::kFrameSize;
+    unsigned char in[kBatchFrames * kFrameSize];
+    unsigned char out[kBatchFrames * kFrameSize];
+    std::size_t buffered = 0;
+    std::chrono::steady_clock::time_point pending = std::chrono::steady_clock::now();
+
+    auto send_all = [fd](const unsigned char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t n = send(fd, data, size, kSendFlags);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+        return true;
+    };
+
+    bool alive = true;
+    while (alive && running_) {
+        ssize_t n = recv(fd, in + buffered, sizeof(in) - buffered, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        buffered += static_cast<std::size_t>(n);
+
+        std::size_t frames = buffered / kFrameSize;
+        std::size_t replies = 0;
+        for (std::size_t i = 0; i < frames; ++i) {
+            binproto::Request request = binproto::decode_request(in + i * kFrameSize);
+            // A completion wait can be long; don't hold back the replies before it
+            if (request.opcode == binproto::Opcode::Complete && replies > 0) {
+                alive = send_all(out, replies * kFrameSize);
+                replies = 0;
+            }
+            binproto::encode_reply(handler_(request, pending), out + replies * kFrameSize);
+            ++replies;
+        }
+        if (alive && replies > 0) {
+            alive = send_all(out, replies * kFrameSize);
+        }
+
+        // Keep a trailing partial frame for the next read
+        std::size_t used = frames * kFrameSize;
+        std::memmove(in, in + used, buffered - used);
+        buffered -= used;
+    }
+
+    // Untrack before closing so a new client reusing the descriptor is not lost
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    clients_.erase(fd);
+    close(fd);
+    clients_done_.notify_all();
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef BINARY_SERVER_HPP
+#define BINARY_SERVER_HPP
+
+#include "binary_protocol.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Listener for the fixed-size frames of binary_protocol.hpp, on a TCP port
+// and/or a Unix domain socket (POSIX only; listen_* fail on Windows). One
+// thread per client: frames that arrive together are handled back to back
+// and their replies written with a single send, so pipelining clients pay
+// one syscall pair per batch rather than per command.
+class BinaryServer {
+public:
+    // pending is per connection: the settle deadline of the writes issued so
+    // far, which Opcode::Complete waits for
+    using Handler = std::function<binproto::Reply(const binproto::Request& request,
+                                                  std::chrono::steady_clock::time_point& pending)>;
+
+    explicit BinaryServer(Handler handler);
+    ~BinaryServer();
+
+    BinaryServer(const BinaryServer&) = delete;
+    BinaryServer& operator=(const BinaryServer&) = delete;
+
+    bool listen_tcp(const std::string& host, int port);
+    bool listen_unix(const std::string& path);
+    void stop();
+
+private:
+    bool add_listener(int fd);
+    void accept_loop(int listen_fd);
+    void serve(int fd);
+
+    Handler handler_;
+    std::atomic<bool> running_;
+    std::vector<int> listeners_;
+    std::vector<std::thread> acceptors_;
+    std::string unix_path_;
+
+    std::mutex clients_mutex_;
+    std::condition_variable clients_done_;
+    std::unordered_set<int> clients_;
+};
+
+#endif
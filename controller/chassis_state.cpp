@@ -0,0 +1,72 @@
+#include "chassis_state.hpp"
+
+ChassisState::ChassisState() : sequence_(0), current_path_(kNoPath), last_switch_(-1) {
+    for (int i = 0; i < kMaxSwitches; ++i) {
+        positions_[i].store(kUnknownPosition, std::memory_order_relaxed);
+        odometers_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+ChassisState::Snapshot ChassisState::snapshot() const {
+    Snapshot snap;
+    while (true) {
+        std::uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;  // writer active; writes are a handful of stores
+        }
+        snap.current_path = current_path_.load(std::memory_order_relaxed);
+        for (int i = 0; i < kMaxSwitches; ++i) {
+            snap.positions[i] = positions_[i].load(std::memory_order_relaxed);
+            snap.odometers[i] = odometers_[i].load(std::memory_order_relaxed);
+        }
+        snap.last_switch = last_switch_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) == before) {
+            snap.version = before / 2;
+            return snap;
+        }
+    }
+}
+
+int ChassisState::position(int slot) const {
+    if (slot < 0 || slot >= kMaxSwitches) {
+        return kUnknownPosition;
+    }
+    return positions_[slot].load(std::memory_order_acquire);
+}
+
+void ChassisState::begin_write() {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ChassisState::end_write() {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void ChassisState::set_current_path(int path_id) {
+    std::lock_guard<std::mutex> lock(writer_);
+    begin_write();
+    current_path_.store(path_id, std::memory_order_relaxed);
+    end_write();
+}
+
+void ChassisState::set_switch(int slot, int position, std::uint64_t odometer) {
+    if (slot < 0 || slot >= kMaxSwitches) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer_);
+    begin_write();
+    positions_[slot].store(position, std::memory_order_relaxed);
+    odometers_[slot].store(odometer, std::memory_order_relaxed);
+    last_switch_.store(slot, std::memory_order_relaxed);
+    end_write();
+}
+
+int ChassisState::switch_slot(const std::string& switch_id) {
+    if (switch_id.size() != 3 || switch_id[0] != 'S' || switch_id[1] != 'W') {
+        return -1;
+    }
+    int number = switch_id[2] - '0';
+    return number >= 1 && number <= kMaxSwitches ? number - 1 : -1;
+}
@@ -0,0 +1,70 @@
+#ifndef CHASSIS_STATE_HPP
+#define CHASSIS_STATE_HPP
+
+#include "shadow_registers.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// What the controller believes the chassis looks like: selected path,
+// position and odometer of every switch, and the shadow register map.
+//
+// /status and /config poll this from many httplib workers, so reads are
+// lock free: the published fields are atomics guarded by a seqlock and a
+// reader simply retries if a writer was active. Writers are serialised;
+// state-changing commands additionally hold lock_commands() so that
+// read-modify-write sequences such as SWITCH:SELECT (which depends on the
+// selected path) cannot interleave.
+class ChassisState {
+public:
+    static constexpr int kMaxSwitches = 8;  // SW1 .. SW8
+    static constexpr int kNoPath = -1;
+    static constexpr int kUnknownPosition = -1;
+
+    struct Snapshot {
+        std::uint64_t version = 0;  // bumps on every change
+        int current_path = kNoPath;
+        std::array<int, kMaxSwitches> positions{};        // gpio value, kUnknownPosition if never set
+        std::array<std::uint64_t, kMaxSwitches> odometers{};
+        int last_switch = -1;  // slot moved most recently, -1 before the first move
+    };
+
+    ChassisState();
+
+    ChassisState(const ChassisState&) = delete;
+    ChassisState& operator=(const ChassisState&) = delete;
+
+    // Lock free
+    Snapshot snapshot() const;
+    int current_path() const { return current_path_.load(std::memory_order_acquire); }
+    std::uint64_t version() const { return sequence_.load(std::memory_order_acquire) / 2; }
+    int position(int slot) const;  // kUnknownPosition for a switch never set or out of range
+
+    // Held by the command path around every state-changing command
+    std::unique_lock<std::mutex> lock_commands() { return std::unique_lock<std::mutex>(commands_); }
+
+    void set_current_path(int path_id);
+    void set_switch(int slot, int position, std::uint64_t odometer);
+
+    ShadowRegisters& registers() { return registers_; }
+
+    // "SW1" -> 0 ... "SW8" -> 7, -1 for anything else
+    static int switch_slot(const std::string& switch_id);
+
+private:
+    void begin_write();
+    void end_write();
+
+    std::mutex commands_;
+    std::mutex writer_;
+    std::atomic<std::uint64_t> sequence_;  // odd while a write is in progress
+    std::atomic<int> current_path_;
+    std::array<std::atomic<int>, kMaxSwitches> positions_;
+    std::array<std::atomic<std::uint64_t>, kMaxSwitches> odometers_;
+    std::atomic<int> last_switch_;
+    ShadowRegisters registers_;
+};
+
+#endif
@@ -0,0 +1,424 @@
+#include "command_body.hpp"
+#include <cstdint>
+
+namespace command_body {
+
+namespace {
+
+// Deeper nesting than any real client sends is refused instead of recursed into
+constexpr int kMaxDepth = 32;
+
+constexpr std::string_view kFieldLiteral = "\"scpi_command\"";
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Recursive descent over RFC 8259 JSON, as strict as nlohmann::json::parse
+// (escapes, surrogate pairs and UTF-8 are checked), but it only records
+// where things are.
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : text_(text) {}
+
+    Error scan_body(Body& out) {
+        skip_space();
+        bool found = false;
+        bool wrong_type = false;
+        if (peek() == '{') {
+            ++pos_;
+            if (!scan_members(out, found, wrong_type)) {
+                return Error::Malformed;
+            }
+        } else if (!scan_value(0)) {
+            return Error::Malformed;
+        }
+        skip_space();
+        if (pos_ != text_.size()) {
+            return Error::Malformed;
+        }
+        if (!found) {
+            return Error::MissingField;
+        }
+        return wrong_type ? Error::WrongType : Error::None;
+    }
+
+private:
+    char peek() const { return pos_ < text_.size() ? text_[pos_] : '\0'; }
+
+    void skip_space() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool expect(char c) {
+        skip_space();
+        if (peek() != c) {
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    // Top-level object: like scan_value, but notes scpi_command on the way.
+    // A repeated key wins over earlier ones, as in nlohmann::json.
+    bool scan_members(Body& out, bool& found, bool& wrong_type) {
+        skip_space();
+        if (peek() == '}') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            std::size_t key_start = pos_;
+            if (!scan_string()) {
+                return false;
+            }
+            std::string_view key = text_.substr(key_start, pos_ - key_start);
+            if (!expect(':')) {
+                return false;
+            }
+            skip_space();
+            std::size_t value_start = pos_;
+            if (is_field(key)) {
+                found = true;
+                if (peek() == '[') {
+                    out.batch = true;
+                    if (!scan_string_array(wrong_type)) {
+                        return false;
+                    }
+                } else {
+                    out.batch = false;
+                    wrong_type = peek() != '"';
+                    if (!scan_value(1)) {
+                        return false;
+                    }
+                }
+                out.command = text_.substr(value_start, pos_ - value_start);
+            } else if (!scan_value(1)) {
+                return false;
+            }
+            skip_space();
+            if (peek() == ',') {
+                ++pos_;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+
+    static bool is_field(std::string_view key) {
+        if (key == kFieldLiteral) {
+            return true;
+        }
+        if (key.find('\\') == std::string_view::npos) {
+            return false;
+        }
+        std::string scratch;  // escaped key, never seen in practice
+        return decode_string(key, scratch) == kFieldLiteral.substr(1, kFieldLiteral.size() - 2);
+    }
+
+    bool scan_string_array(bool& wrong_type) {
+        wrong_type = false;
+        ++pos_;  // '['
+        skip_space();
+        if (peek() == ']') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skip_space();
+            if (peek() != '"') {
+                wrong_type = true;
+            }
+            if (!scan_value(2)) {
+                return false;
+            }
+            skip_space();
+            if (peek() == ',') {
+                ++pos_;
+                continue;
+            }
+            return expect(']');
+        }
+    }
+
+    bool scan_value(int depth) {
+        if (depth > kMaxDepth) {
+            return false;
+        }
+        skip_space();
+        switch (peek()) {
+        case '"': return scan_string();
+        case '{': return scan_container('}', true, depth);
+        case '[': return scan_container(']', false, depth);
+        case 't': return scan_literal("true");
+        case 'f': return scan_literal("false");
+        case 'n': return scan_literal("null");
+        default: return scan_number();
+        }
+    }
+
+    bool scan_container(char close, bool object, int depth) {
+        ++pos_;
+        skip_space();
+        if (peek() == close) {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            if (object) {
+                skip_space();
+                if (!scan_string() || !expect(':')) {
+                    return false;
+                }
+            }
+            if (!scan_value(depth + 1)) {
+                return false;
+            }
+            skip_space();
+            if (peek() == ',') {
+                ++pos_;
+                continue;
+            }
+            return expect(close);
+        }
+    }
+
+    bool scan_literal(std::string_view literal) {
+        if (text_.substr(pos_, literal.size()) != literal) {
+            return false;
+        }
+        pos_ += literal.size();
+        return true;
+    }
+
+    bool scan_digits() {
+        std::size_t start = pos_;
+        while (peek() >= '0' && peek() <= '9') {
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    bool scan_number() {
+        if (peek() == '-') {
+            ++pos_;
+        }
+        if (peek() == '0') {
+            ++pos_;
+        } else if (!scan_digits()) {
+            return false;
+        }
+        if (peek() == '.') {
+            ++pos_;
+            if (!scan_digits()) {
+                return false;
+            }
+        }
+        if (peek() == 'e' || peek() == 'E') {
+            ++pos_;
+            if (peek() == '+' || peek() == '-') {
+                ++pos_;
+            }
+            if (!scan_digits()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Four hex digits after "\u"
+    bool scan_code_unit(unsigned& unit) {
+        if (pos_ + 4 > text_.size()) {
+            return false;
+        }
+        unit = 0;
+        for (int k = 0; k < 4; ++k) {
+            int digit = hex_value(text_[pos_++]);
+            if (digit < 0) {
+                return false;
+            }
+            unit = unit * 16 + static_cast<unsigned>(digit);
+        }
+        return true;
+    }
+
+    bool scan_escape() {
+        switch (peek()) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            ++pos_;
+            return true;
+        case 'u': {
+            ++pos_;
+            unsigned unit;
+            if (!scan_code_unit(unit) || (unit >= 0xDC00 && unit <= 0xDFFF)) {
+                return false;
+            }
+            if (unit >= 0xD800 && unit <= 0xDBFF) {
+                unsigned low;
+                return scan_literal("\\u") && scan_code_unit(low) && low >= 0xDC00 && low <= 0xDFFF;
+            }
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    // One UTF-8 sequence starting with a byte >= 0x80
+    bool scan_utf8() {
+        auto byte = [this](std::size_t at) {
+            return at < text_.size() ? static_cast<std::uint8_t>(text_[at]) : 0;
+        };
+        std::uint8_t lead = byte(pos_);
+        std::uint8_t low = 0x80;
+        std::uint8_t high = 0xBF;
+        int continuation;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            continuation = 1;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            continuation = 2;
+            if (lead == 0xE0) low = 0xA0;   // overlong
+            if (lead == 0xED) high = 0x9F;  // surrogates
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            continuation = 3;
+            if (lead == 0xF0) low = 0x90;   // overlong
+            if (lead == 0xF4) high = 0x8F;  // above U+10FFFF
+        } else {
+            return false;
+        }
+        for (int k = 1; k <= continuation; ++k) {
+            std::uint8_t b = byte(pos_ + k);
+            if (b < (k == 1 ? low : 0x80) || b > (k == 1 ? high : 0xBF)) {
+                return false;
+            }
+        }
+        pos_ += continuation + 1;
+        return true;
+    }
+
+    bool scan_string() {
+        if (peek() != '"') {
+            return false;
+        }
+        ++pos_;
+        while (pos_ < text_.size()) {
+            unsigned char c = static_cast<unsigned char>(text_[pos_]);
+            if (c == '"') {
+                ++pos_;
+                return true;
+            }
+            if (c < 0x20) {
+                return false;
+            }
+            if (c == '\\') {
+                ++pos_;
+                if (!scan_escape()) {
+                    return false;
+                }
+            } else if (c >= 0x80) {
+                if (!scan_utf8()) {
+                    return false;
+                }
+            } else {
+                ++pos_;
+            }
+        }
+        return false;  // unterminated
+    }
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+};
+
+void append_utf8(std::string& out, unsigned code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+unsigned read_code_unit(std::string_view text, std::size_t at) {
+    unsigned unit = 0;
+    for (std::size_t k = 0; k < 4; ++k) {
+        unit = unit * 16 + static_cast<unsigned>(hex_value(text[at + k]));
+    }
+    return unit;
+}
+
+} // namespace
+
+Error scan(std::string_view body, Body& out) {
+    out = Body();
+    if (body.size() > kMaxBodySize) {
+        return Error::TooLarge;
+    }
+    return Scanner(body).scan_body(out);
+}
+
+const char* describe(Error error) {
+    switch (error) {
+    case Error::None: return "ok";
+    case Error::TooLarge: return "request body too large";
+    case Error::Malformed: return "malformed JSON";
+    case Error::MissingField: return "Missing 'scpi_command' field";
+    case Error::WrongType: return "'scpi_command' must be a string or an array of strings";
+    }
+    return "invalid request";
+}
+
+std::string_view decode_string(std::string_view literal, std::string& scratch) {
+    std::string_view inner = literal.substr(1, literal.size() - 2);
+    std::size_t backslash = inner.find('\\');
+    if (backslash == std::string_view::npos) {
+        return inner;
+    }
+
+    scratch.assign(inner.data(), backslash);
+    for (std::size_t i = backslash; i < inner.size(); ++i) {
+        if (inner[i] != '\\') {
+            scratch += inner[i];
+            continue;
+        }
+        char escape = inner[++i];
+        switch (escape) {
+        case 'b': scratch += '\b'; break;
+        case 'f': scratch += '\f'; break;
+        case 'n': scratch += '\n'; break;
+        case 'r': scratch += '\r'; break;
+        case 't': scratch += '\t'; break;
+        case 'u': {
+            unsigned code_point = read_code_unit(inner, i + 1);
+            i += 4;
+            if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                unsigned low = read_code_unit(inner, i + 3);  // skip "\u"
+                code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            append_utf8(scratch, code_point);
+            break;
+        }
+        default: scratch += escape; break;  // " \ /
+        }
+    }
+    return scratch;
+}
+
+} // namespace command_body
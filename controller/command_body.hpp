@@ -0,0 +1,62 @@
+#ifndef COMMAND_BODY_HPP
+#define COMMAND_BODY_HPP
+
+// Reader for POST /command bodies, {"scpi_command": "..."} or
+// {"scpi_command": ["...", ...]}. A single pass over the body validates the
+// JSON and locates scpi_command without building a DOM: the result is a
+// view into the body, and strings without escapes (all real traffic) are
+// handed out as views too, so a request costs no allocations here.
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace command_body {
+
+// Larger bodies are refused before they are scanned
+constexpr std::size_t kMaxBodySize = 64 * 1024;
+
+enum class Error {
+    None,
+    TooLarge,
+    Malformed,     // not JSON, or nested deeper than the scanner allows
+    MissingField,  // no scpi_command, or the body is not an object
+    WrongType,     // scpi_command is neither a string nor an array of strings
+};
+
+struct Body {
+    std::string_view command;  // raw JSON text of the scpi_command value, quotes included
+    bool batch = false;        // an array of strings rather than one string
+};
+
+Error scan(std::string_view body, Body& out);
+
+const char* describe(Error error);
+
+// JSON string literal (quotes included, already validated by scan) to its
+// value. Returns a view into literal when there is nothing to unescape,
+// otherwise decodes into scratch and returns a view of it.
+std::string_view decode_string(std::string_view literal, std::string& scratch);
+
+// Calls f(std::string_view) for every string of a validated scpi_command
+// value: the string itself, or each element of the array in order.
+template <typename F>
+void for_each_string(std::string_view value, std::string& scratch, F&& f) {
+    std::size_t i = 0;
+    while (i < value.size()) {
+        if (value[i] != '"') {
+            ++i;
+            continue;
+        }
+        std::size_t end = i + 1;
+        while (value[end] != '"') {
+            end += value[end] == '\\' ? 2 : 1;
+        }
+        f(decode_string(value.substr(i, end + 1 - i), scratch));
+        i = end + 1;
+    }
+}
+
+} // namespace command_body
+
+#endif
@@ -0,0 +1,521 @@
+#include "command_core.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+// Relays are busy for this long after a write (see Ramiro/fake_fpga). Writes
+// to one relay are spaced by it; different relays switch concurrently.
+constexpr std::chrono::milliseconds kRelaySettleTime(150);
+
+// Route table compiled from paths.json and components_paths.json. Replaced
+// as a whole by the config watcher; requests keep the snapshot they loaded.
+std::shared_ptr<const RouteTable> route_table;
+
+} // namespace
+
+Logger& logger = Logger::instance();
+ChassisState chassis;
+EventHub events;
+LatencyHistograms latency({"command", "body_parse", "route_snapshot", "scpi_parse", "execute", "serialize",
+                           "axi_write", "odometer"});
+thread_local std::string json_buffer;
+thread_local std::string event_buffer;
+SwitchScheduler switch_scheduler(kRelaySettleTime);
+std::unique_ptr<RegisterMap> axi_registers;
+OdometerStore odometers;
+
+namespace {
+
+void notify_path(int path_id) {
+    JsonWriter json(event_buffer);
+    json.begin_object().key(kCurrentPathKey).value(path_id).end_object();
+    events.publish("path", event_buffer);
+}
+
+void notify_switch(std::string_view switch_id, int position, uint64_t odometer) {
+    JsonWriter json(event_buffer);
+    json.begin_object();
+    json.key(kSwitchKey).value(switch_id);
+    json.key(kPositionKey).value(position);
+    json.key(kOdometerKey).value(odometer);
+    json.end_object();
+    events.publish("switch", event_buffer);
+}
+
+int write_to_axi(uint32_t addr, uint8_t value) {
+    LatencyHistograms::Scope timing(latency, kStageAxiWrite);
+    if (!axi_registers->write8(addr, value)) {
+        logger.error("AXI write outside the register window", {{"address", addr}, {"value", value},
+                                                               {"base", axi_registers->base()},
+                                                               {"size", axi_registers->size()}});
+        return -1;
+    }
+    logger.debug("AXI write", {{"address", addr}, {"value", value}});
+    return 0;
+}
+
+// Counts a relay write that really moves the switch; rewriting the position
+// it is already in is not an actuation. Returns the switch's total.
+uint64_t count_actuation(int slot, int gpio_value) {
+    LatencyHistograms::Scope timing(latency, kStageOdometer);
+    if (chassis.position(slot) == gpio_value) {
+        return odometers.total(slot);
+    }
+    return odometers.record(slot, gpio_value);
+}
+
+// One relay write as queued on switch_scheduler. Small enough for
+// std::function's local buffer (two words, even on 32-bit ARM), so queuing
+// it does not allocate; hence no strings, and the switch id is rebuilt from
+// the slot when the write runs.
+struct RelayWrite {
+    uint32_t address;
+    uint8_t value;
+    int8_t slot;      // ChassisState slot, -1 for components outside SW1..SW8
+    uint8_t path;     // selected path, for the log
+    bool whole_path;  // issued by PATH:SELECT rather than SWITCH:SELECT
+
+    void operator()() const {
+        if (write_to_axi(address, value) != 0) {
+            chassis.registers().invalidate(address);
+            return;
+        }
+        uint64_t odometer = count_actuation(slot, value);
+        chassis.set_switch(slot, value, odometer);
+        if (slot < 0) {
+            // Not tracked by the chassis state, so no event either
+            logger.info("Untracked relay written", {{"path", path}, {"address", address}, {"gpio_value", value}});
+            return;
+        }
+        const char switch_id[] = {'S', 'W', static_cast<char>('1' + slot), '\0'};
+        notify_switch(switch_id, value, odometer);
+        logger.info(whole_path ? "Path activated" : "Switch activated",
+                    {{"switch", switch_id}, {"path", path}, {"address", address}, {"gpio_value", value},
+                     {"odometer", odometer}});
+    }
+};
+static_assert(sizeof(RelayWrite) <= 2 * sizeof(void*), "RelayWrite must fit std::function's local buffer");
+
+binproto::Status wire_status(CommandStatus status) {
+    switch (status) {
+    case CommandStatus::Ok: return binproto::Status::Ok;
+    case CommandStatus::InvalidArgument: return binproto::Status::InvalidArgument;
+    case CommandStatus::NotFound: return binproto::Status::NotFound;
+    case CommandStatus::NoPathSelected: return binproto::Status::NoPathSelected;
+    case CommandStatus::ConfigMissing: return binproto::Status::ConfigMissing;
+    case CommandStatus::BadSyntax: return binproto::Status::InvalidArgument;
+    case CommandStatus::UnknownCommand: return binproto::Status::BadOpcode;
+    }
+    return binproto::Status::InvalidArgument;
+}
+
+// "message" of a failed command in a POST /command reply
+const char* describe(CommandStatus status) {
+    switch (status) {
+    case CommandStatus::Ok: return "Command processed successfully";
+    case CommandStatus::InvalidArgument: return "Argument out of range";
+    case CommandStatus::NotFound: return "Path or switch not found in the configuration";
+    case CommandStatus::NoPathSelected: return "No path selected. Select a path before using switch mode";
+    case CommandStatus::ConfigMissing: return "Failed to load paths configuration";
+    case CommandStatus::BadSyntax: return "Invalid command arguments";
+    case CommandStatus::UnknownCommand: return "Unknown command";
+    }
+    return "Unknown command";
+}
+
+} // namespace
+
+std::shared_ptr<const RouteTable> current_routes() {
+    LatencyHistograms::Scope timing(latency, kStageRouteSnapshot);
+    return std::atomic_load(&route_table);
+}
+
+void publish_routes(std::shared_ptr<const RouteTable> routes) {
+    nlohmann::json delta;
+    delta["paths_loaded"] = routes->paths_loaded();
+    delta["components_loaded"] = routes->components_loaded();
+    delta["entries"] = routes->entry_count();
+    std::atomic_store(&route_table, std::move(routes));
+    events.publish("config", delta.dump());
+}
+
+// {"total":N,"positions":[{"position":P,"count":N},...]}, positions never entered left out
+void write_odometer(JsonWriter& json, int slot) {
+    json.begin_object();
+    json.key(kTotalKey).value(odometers.total(slot));
+    json.key(kPositionsKey).begin_array();
+    for (int position = 0; position < OdometerStore::kPositions; ++position) {
+        if (uint64_t count = odometers.count(slot, position)) {
+            json.begin_object().key(kPositionKey).value(position).key(kCountKey).value(count).end_object();
+        }
+    }
+    json.end_array();
+    json.end_object();
+}
+
+// PATH:SELECT: moves every switch of the path, writing only the registers that change
+CommandResult select_path(int path_num, const RouteTable& routes) {
+    CommandResult result{CommandStatus::Ok, SwitchScheduler::Clock::now()};
+    if (!routes.paths_loaded()) {
+        logger.error("Failed to load paths.json");
+        result.status = CommandStatus::ConfigMissing;
+        return result;
+    }
+    if (path_num < 0 || path_num > 255) {
+        logger.warn("Invalid path number", {{"path", path_num}});
+        result.status = CommandStatus::InvalidArgument;
+        return result;
+    }
+
+    auto commands = chassis.lock_commands();
+
+    // Update current path state; an unknown path clears the selection
+    bool path_found = routes.has_path(path_num);
+    chassis.set_current_path(path_found ? path_num : ChassisState::kNoPath);
+    notify_path(path_found ? path_num : ChassisState::kNoPath);
+    if (path_found) {
+        logger.info("Current path set", {{"path", path_num}});
+    }
+
+    // Only registers that change are written; the switches settle in parallel
+    int skipped = 0;
+    for (const PathEntry* path = routes.path_begin(path_num); path != routes.path_end(path_num); ++path) {
+        uint32_t addr = path->address;
+        uint8_t gpio_value = path->gpio_value;
+        if (!chassis.registers().claim(addr, gpio_value)) {
+            ++skipped;
+            continue;
+        }
+        const Component& component = routes.component(path->component);
+        int slot = ChassisState::switch_slot(component.id);
+        RelayWrite write{addr, gpio_value, static_cast<int8_t>(slot), static_cast<uint8_t>(path_num), true};
+        result.settled_at = std::max(result.settled_at, switch_scheduler.submit(component.path_component_id, write));
+    }
+    if (skipped > 0) {
+        logger.debug("Registers already in place", {{"path", path_num}, {"skipped", skipped}});
+    }
+
+    if (!path_found) {
+        logger.warn("No paths found", {{"path", path_num}});
+        result.status = CommandStatus::NotFound;
+    }
+    return result;
+}
+
+// SWITCH:SELECT: moves one switch, at the address the current path uses for it
+CommandResult select_switch(const std::string& switch_id, int gpio_value, const RouteTable& routes) {
+    CommandResult result{CommandStatus::Ok, SwitchScheduler::Clock::now()};
+    if (!routes.paths_loaded()) {
+        logger.error("Failed to load paths.json");
+        result.status = CommandStatus::ConfigMissing;
+        return result;
+    }
+    if (gpio_value < 0 || gpio_value > 255) {
+        logger.warn("Invalid GPIO value. Must be between 0 and 255", {{"gpio_value", gpio_value}});
+        result.status = CommandStatus::InvalidArgument;
+        return result;
+    }
+
+    auto commands = chassis.lock_commands();
+
+    // Check if a path is currently selected
+    int path_num = chassis.current_path();
+    if (path_num == ChassisState::kNoPath) {
+        logger.warn("No path currently selected. Please select a path first before using switch mode.");
+        result.status = CommandStatus::NoPathSelected;
+        return result;
+    }
+
+    logger.debug("Switch ID received", {{"switch", switch_id}, {"gpio_value", gpio_value}, {"path", path_num}});
+    
+    // Map SW1/SW2 to the switch1/switch2 entries of paths.json for address lookup
+    int component = routes.find_component(switch_id);
+    if (component < 0) {
+        logger.warn("Unknown switch ID", {{"switch", switch_id}});
+        result.status = CommandStatus::NotFound;
+        return result;
+    }
+    const std::string& component_id = routes.component(component).path_component_id;
+
+    // Entry that matches both the current path ID and the component
+    const PathEntry* path = routes.find_entry(path_num, component);
+    if (path == nullptr) {
+        logger.warn("Switch not found in path", {{"switch", switch_id}, {"path", path_num}});
+        result.status = CommandStatus::NotFound;
+        return result;
+    }
+
+    uint32_t addr = path->address;
+    int slot = ChassisState::switch_slot(switch_id);
+
+    // Queued behind earlier writes to the same relay only
+    if (chassis.registers().claim(addr, static_cast<uint8_t>(gpio_value))) {
+        RelayWrite write{addr, static_cast<uint8_t>(gpio_value), static_cast<int8_t>(slot),
+                         static_cast<uint8_t>(path_num), false};
+        result.settled_at = switch_scheduler.submit(component_id, write);
+    } else {
+        logger.debug("Switch already in place", {{"switch", switch_id}, {"gpio_value", gpio_value}});
+    }
+    return result;
+}
+
+// Runs a state-changing command; settled_at is when the relay writes it
+// issued will have settled. Queries succeed here and are answered by
+// write_scpi_reply.
+CommandResult process_scpi_command(const scpi::ParsedCommand& cmd, const RouteTable& routes) {
+    // Note: SCPI command logging now happens in the endpoint before this function
+    std::string_view args = cmd.args;
+    CommandResult result{CommandStatus::Ok, SwitchScheduler::Clock::now()};
+
+    switch (cmd.command) {
+    // Handle PATH:SELECT command
+    case scpi::Command::PathSelect: {
+        int path_num;
+        if (!scpi::parse_number(scpi::next_argument(args), path_num)) {
+            logger.warn("Invalid path number format", {{"command", cmd.header}, {"args", cmd.args}});
+            result.status = CommandStatus::BadSyntax;
+            return result;
+        }
+        return select_path(path_num, routes);
+    }
+
+    // Handle SWITCH:SELECT command (with GPIO value parameter, respects current path for address)
+    case scpi::Command::SwitchSelect: {
+        std::string_view switch_str = scpi::next_argument(args);
+        std::string_view gpio_str = scpi::next_argument(args);
+        
+        if (switch_str.empty() || gpio_str.empty()) {
+            logger.warn("Invalid SWITCH:SELECT format. Use: SWITCH:SELECT <switch_id> <gpio_value>");
+            result.status = CommandStatus::BadSyntax;
+            return result;
+        }
+
+        int gpio_value;
+        if (!scpi::parse_number(gpio_str, gpio_value)) {
+            logger.warn("Invalid GPIO value format", {{"gpio_value", gpio_str}});
+            result.status = CommandStatus::BadSyntax;
+            return result;
+        }
+        return select_switch(std::string(switch_str), gpio_value, routes);
+    }
+
+    // Queries are answered by write_scpi_reply
+    case scpi::Command::SwitchInfo:
+    case scpi::Command::OperationComplete:
+    case scpi::Command::State:
+        return result;
+
+    default:
+        break;
+    }
+
+    // If we get here, command format was not recognized
+    logger.warn("Unknown command format. Supported commands: PATH:SELECT <path_id>, "
+                "SWITCH:SELECT <switch_id> <gpio_value>, SWITCH:INFO? <switch_number>, *OPC?, STATE?",
+                {{"command", cmd.header}});
+    result.status = CommandStatus::UnknownCommand;
+    return result;
+}
+
+// Binary protocol front end: the same command core as POST /command without
+// the HTTP, JSON and SCPI text layers. pending is per connection.
+binproto::Reply run_binary_command(const binproto::Request& request, SwitchScheduler::Clock::time_point& pending) {
+    binproto::Reply reply{request.opcode, binproto::Status::Ok, 0, 0, request.tag};
+    std::shared_ptr<const RouteTable> routes = current_routes();
+
+    switch (request.opcode) {
+    case binproto::Opcode::PathSelect: {
+        CommandResult result = select_path(request.path_id, *routes);
+        reply.status = wire_status(result.status);
+        pending = std::max(pending, result.settled_at);
+        break;
+    }
+    case binproto::Opcode::SwitchSelect: {
+        CommandResult result = select_switch("SW" + std::to_string(request.switch_number), request.gpio_value, *routes);
+        reply.status = wire_status(result.status);
+        pending = std::max(pending, result.settled_at);
+        break;
+    }
+    case binproto::Opcode::Complete:
+        switch_scheduler.completion(pending).wait();
+        break;
+    case binproto::Opcode::Status:
+        break;
+    default:
+        reply.status = binproto::Status::BadOpcode;
+        break;
+    }
+
+    reply.current_path = static_cast<int16_t>(chassis.current_path());
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(pending - SwitchScheduler::Clock::now()).count();
+    reply.settle_ms = static_cast<uint16_t>(std::min<long long>(std::max<long long>(remaining, 0), 0xffff));
+    return reply;
+}
+
+// Switches that have been moved since startup, keyed by SCPI id
+nlohmann::json switches_json(const ChassisState::Snapshot& state) {
+    nlohmann::json switches = nlohmann::json::object();
+    for (int slot = 0; slot < ChassisState::kMaxSwitches; ++slot) {
+        if (state.positions[slot] != ChassisState::kUnknownPosition) {
+            std::string id = "SW" + std::to_string(slot + 1);
+            switches[id]["position"] = state.positions[slot];
+            switches[id]["odometer"] = state.odometers[slot];
+        }
+    }
+    return switches;
+}
+
+// STATE? reply. switch/path/busy keep the meaning they have on Ramiro/fake_fpga
+// (last switch moved and its position) so the RFIU UI reads it unchanged.
+nlohmann::json state_json() {
+    ChassisState::Snapshot state = chassis.snapshot();
+    nlohmann::json response;
+    response["switch"] = state.last_switch + 1;
+    response["path"] = state.last_switch >= 0 ? state.positions[state.last_switch] : 0;
+    response["busy"] = switch_scheduler.idle_at() > SwitchScheduler::Clock::now();
+    response["current_path"] = state.current_path;
+    response["state_version"] = state.version;
+    response["switches"] = switches_json(state);
+    return response;
+}
+
+// Raw SCPI socket front end (port 5025), in the reply dialect of
+// Ramiro/fake_fpga: "OK", "ERR,<reason>" or the query result on one line.
+// *OPC? never reaches this function, ScpiServer parks the session itself.
+std::string run_socket_command(const scpi::ParsedCommand& cmd, SwitchScheduler::Clock::time_point& pending) {
+    std::shared_ptr<const RouteTable> routes = current_routes();
+    std::string_view args = cmd.args;
+    CommandResult result{CommandStatus::Ok, pending};
+
+    switch (cmd.command) {
+    case scpi::Command::PathSelect: {
+        int path_num;
+        if (!scpi::parse_number(scpi::next_argument(args), path_num)) {
+            return "ERR,BAD_SYNTAX";
+        }
+        result = select_path(path_num, *routes);
+        if (result.status == CommandStatus::NotFound) {
+            return "ERR,INVALID_PATH";
+        }
+        break;
+    }
+    case scpi::Command::SwitchSelect: {
+        // "SW1 2" as over HTTP, or "1 2" as fake_fpga accepts
+        std::string switch_id(scpi::next_argument(args));
+        int gpio_value;
+        if (switch_id.empty() || !scpi::parse_number(scpi::next_argument(args), gpio_value)) {
+            return "ERR,BAD_SYNTAX";
+        }
+        if (switch_id.front() >= '0' && switch_id.front() <= '9') {
+            switch_id.insert(0, "SW");
+        }
+        result = select_switch(switch_id, gpio_value, *routes);
+        break;
+    }
+    case scpi::Command::SwitchInfo: {
+        if (!routes->components_loaded()) {
+            return "ERR,NO_CONFIG";
+        }
+        int component = routes->find_component("SW" + std::string(scpi::next_argument(args)));
+        if (component < 0 || routes->component(component).info.is_null()) {
+            return "ERR,NOT_FOUND";
+        }
+        return routes->component(component).info_json;
+    }
+    case scpi::Command::State:
+        return state_json().dump();
+    default:
+        logger.warn("Unknown SCPI socket command", {{"command", cmd.header}});
+        return "ERR,UNKNOWN";
+    }
+
+    pending = std::max(pending, result.settled_at);
+    switch (result.status) {
+    case CommandStatus::Ok: return "OK";
+    case CommandStatus::InvalidArgument: return "ERR,INVALID_ARGS";
+    case CommandStatus::NotFound: return "ERR,NOT_FOUND";
+    case CommandStatus::NoPathSelected: return "ERR,NO_PATH";
+    case CommandStatus::ConfigMissing: return "ERR,NO_CONFIG";
+    case CommandStatus::BadSyntax: return "ERR,BAD_SYNTAX";
+    case CommandStatus::UnknownCommand: return "ERR,UNKNOWN";
+    }
+    return "ERR,UNKNOWN";
+}
+
+// Runs one command against a route snapshot and writes its reply object.
+// pending is the settle deadline of the writes issued so far; *OPC? blocks
+// until it has passed. HTTP clients send one command per request, so a
+// request starts from switch_scheduler.idle_at() and a standalone *OPC?
+// waits for the relays moved by earlier requests.
+void write_scpi_reply(JsonWriter& json, const scpi::ParsedCommand& cmd, const RouteTable& routes,
+                      SwitchScheduler::Clock::time_point& pending) {
+    if (cmd.command == scpi::Command::OperationComplete) {
+        switch_scheduler.completion(pending).wait();
+        json.begin_object();
+        json.key(kStatusKey).value("OK");
+        json.key(kOpcKey).value(1);
+        json.key(kCurrentPathKey).value(chassis.current_path());
+        json.end_object();
+        return;
+    }
+
+    if (cmd.command == scpi::Command::State) {
+        nlohmann::json response;
+        {
+            LatencyHistograms::Scope timing(latency, kStageExecute);
+            response = state_json();
+            response["status"] = "OK";
+        }
+        LatencyHistograms::Scope timing(latency, kStageSerialize);
+        json.raw(response.dump());
+        return;
+    }
+
+    // Special handling for SWITCH:INFO? command
+    if (cmd.command == scpi::Command::SwitchInfo) {
+        LatencyHistograms::Scope timing(latency, kStageSerialize);  // a lookup, the rest is writing
+        std::string_view args = cmd.args;
+        std::string switch_id = "SW" + std::string(scpi::next_argument(args));
+        
+        json.begin_object();
+        if (routes.components_loaded()) {
+            // Find the requested switch component
+            int component = routes.find_component(switch_id);
+            if (component >= 0 && !routes.component(component).info.is_null()) {
+                json.key(kStatusKey).value("OK");
+                json.key(kComponentInfoKey).raw(routes.component(component).info_json);
+                int slot = ChassisState::switch_slot(switch_id);
+                if (slot >= 0) {
+                    json.key(kOdometerKey);
+                    write_odometer(json, slot);
+                }
+                json.key(kMessageKey).value("Component information retrieved successfully");
+            } else {
+                json.key(kStatusKey).value("ERROR");
+                json.key(kMessageKey).concat({"Component ", switch_id, " not found"});
+            }
+        } else {
+            json.key(kStatusKey).value("ERROR");
+            json.key(kMessageKey).value("Failed to load components configuration");
+        }
+        json.end_object();
+        return;
+    }
+    
+    // Process other SCPI commands normally
+    CommandResult result;
+    {
+        LatencyHistograms::Scope timing(latency, kStageExecute);
+        result = process_scpi_command(cmd, routes);
+        pending = std::max(pending, result.settled_at);
+    }
+    
+    LatencyHistograms::Scope timing(latency, kStageSerialize);
+    json.begin_object();
+    json.key(kStatusKey).value(result.status == CommandStatus::Ok ? "OK" : "ERROR");
+    json.key(kMessageKey).value(describe(result.status));
+    json.key(kCurrentPathKey).value(chassis.current_path());
+    json.end_object();
+}
@@ -0,0 +1,119 @@
+#ifndef COMMAND_CORE_HPP
+#define COMMAND_CORE_HPP
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "binary_protocol.hpp"
+#include "chassis_state.hpp"
+#include "event_hub.hpp"
+#include "json_writer.hpp"
+#include "latency_histograms.hpp"
+#include "logger.hpp"
+#include "odometer_store.hpp"
+#include "register_map.hpp"
+#include "route_table.hpp"
+#include "scpi_parser.hpp"
+#include "switch_scheduler.hpp"
+
+// sfp_server's command path, shared by its front ends (POST /command, the
+// SCPI socket, binary frames) and linked on its own into
+// bench/command_core_bench. There is one chassis per process, so the state
+// is a set of globals, as it was in sfp_server.cpp.
+
+extern Logger& logger;
+
+// Selected path, switch positions, odometers and shadow registers. Read
+// lock free by the status endpoints, written by the command path.
+extern ChassisState chassis;
+
+// Change notifications streamed to GET /events
+extern EventHub events;
+
+// Where the time of a command goes, per stage; GET /metrics
+enum Stage {
+    kStageCommand,        // whole POST /command handler
+    kStageBodyParse,      // locating scpi_command in the body
+    kStageRouteSnapshot,  // loading the current route table (was reading the config files)
+    kStageScpiParse,
+    kStageExecute,        // running the command, up to queuing its relay writes
+    kStageSerialize,      // writing the reply
+    kStageAxiWrite,
+    kStageOdometer,
+};
+extern LatencyHistograms latency;
+
+// Reply and event JSON are written into these; reused by each thread, so
+// steady state command handling does not allocate for them. Separate
+// because commands publish events while their reply is being written.
+extern thread_local std::string json_buffer;
+extern thread_local std::string event_buffer;
+
+// Relay writes, spaced by the settle time per relay
+extern SwitchScheduler switch_scheduler;
+
+// AXI GPIO register window, chosen at startup by SFP_REGISTERS
+extern std::unique_ptr<RegisterMap> axi_registers;
+
+// Actuations per switch and position, persisted to SFP_ODOMETER_FILE
+extern OdometerStore odometers;
+
+constexpr auto kCurrentPathKey = json_key("current_path");
+constexpr auto kSwitchKey = json_key("switch");
+constexpr auto kPositionKey = json_key("position");
+constexpr auto kOdometerKey = json_key("odometer");
+constexpr auto kTotalKey = json_key("total");
+constexpr auto kPositionsKey = json_key("positions");
+constexpr auto kCountKey = json_key("count");
+constexpr auto kFileKey = json_key("file");
+constexpr auto kPersistedSequenceKey = json_key("persisted_sequence");
+constexpr auto kSwitchesKey = json_key("switches");
+constexpr auto kStatusKey = json_key("status");
+constexpr auto kMessageKey = json_key("message");
+constexpr auto kOpcKey = json_key("opc");
+constexpr auto kComponentInfoKey = json_key("component_info");
+constexpr auto kResultsKey = json_key("results");
+
+// Current route table snapshot, and replacing it (publishes a "config" event)
+std::shared_ptr<const RouteTable> current_routes();
+void publish_routes(std::shared_ptr<const RouteTable> routes);
+
+// {"total":N,"positions":[{"position":P,"count":N},...]}
+void write_odometer(JsonWriter& json, int slot);
+
+// Outcome of a state-changing command, shared by the HTTP and binary front ends
+enum class CommandStatus : uint8_t {
+    Ok,
+    InvalidArgument,
+    NotFound,        // path or switch not in the route table
+    NoPathSelected,
+    ConfigMissing,   // paths.json failed to load
+    BadSyntax,       // missing or non-numeric arguments
+    UnknownCommand,
+};
+
+struct CommandResult {
+    CommandStatus status;
+    SwitchScheduler::Clock::time_point settled_at;  // when the relay writes it issued will have settled
+};
+
+CommandResult select_path(int path_num, const RouteTable& routes);
+CommandResult select_switch(const std::string& switch_id, int gpio_value, const RouteTable& routes);
+
+// Runs one parsed SCPI command; queries are left to write_scpi_reply
+CommandResult process_scpi_command(const scpi::ParsedCommand& cmd, const RouteTable& routes);
+
+// Front ends. pending is the settle deadline of the writes issued so far,
+// per connection or request; *OPC? and binary Complete wait for it.
+binproto::Reply run_binary_command(const binproto::Request& request, SwitchScheduler::Clock::time_point& pending);
+std::string run_socket_command(const scpi::ParsedCommand& cmd, SwitchScheduler::Clock::time_point& pending);
+void write_scpi_reply(JsonWriter& json, const scpi::ParsedCommand& cmd, const RouteTable& routes,
+                      SwitchScheduler::Clock::time_point& pending);
+
+// Switches moved since startup, keyed by SCPI id, and the STATE? reply
+nlohmann::json switches_json(const ChassisState::Snapshot& state);
+nlohmann::json state_json();
+
+#endif
@@ -0,0 +1,100 @@
+#include "config_document.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <zlib.h>
+
+namespace {
+
+// FNV-1a; only has to tell documents apart, not resist attackers
+std::string quoted_hash(const std::string& data, const char* suffix) {
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char text[40];
+    std::snprintf(text, sizeof(text), "\"%016llx%s\"", static_cast<unsigned long long>(hash), suffix);
+    return text;
+}
+
+bool gzip_compress(const std::string& input, std::string& output) {
+    z_stream stream{};
+    // 15 window bits + 16 selects the gzip wrapper instead of raw zlib
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    output.resize(deflateBound(&stream, static_cast<uLong>(input.size())));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream.avail_out = static_cast<uInt>(output.size());
+    int rc = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (rc != Z_STREAM_END) {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+ConfigDocument::Representation represent(std::string body) {
+    ConfigDocument::Representation rep;
+    rep.body = std::move(body);
+    rep.etag = quoted_hash(rep.body, "");
+    if (gzip_compress(rep.body, rep.gzip)) {
+        rep.gzip_etag = quoted_hash(rep.body, "-gzip");
+    }
+    return rep;
+}
+
+} // namespace
+
+std::shared_ptr<const ConfigDocument> ConfigDocument::build(std::shared_ptr<const RouteTable> routes,
+                                                            int current_path) {
+    nlohmann::json combined_config;
+
+    // Paths from paths.json and components from components_paths.json, as loaded at startup
+    combined_config["paths"] = routes->paths_json();
+    combined_config["components"] = routes->components_json();
+
+    // Add current path information
+    combined_config["current_path"] = current_path;
+
+    std::shared_ptr<ConfigDocument> document(new ConfigDocument());
+    document->routes_ = std::move(routes);
+    document->current_path_ = current_path;
+    document->pretty_ = represent(combined_config.dump(4));
+    document->compact_ = represent(combined_config.dump());
+    return document;
+}
+
+bool ConfigDocument::etag_matches(const std::string& if_none_match, const std::string& etag) {
+    if (if_none_match.empty()) {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < if_none_match.size()) {
+        size_t comma = if_none_match.find(',', pos);
+        size_t end = comma == std::string::npos ? if_none_match.size() : comma;
+        size_t first = if_none_match.find_first_not_of(" \t", pos);
+        size_t last = if_none_match.find_last_not_of(" \t", end - 1);
+        if (first != std::string::npos && first < end && last >= first) {
+            std::string candidate = if_none_match.substr(first, last - first + 1);
+            if (candidate == "*") {
+                return true;
+            }
+            if (candidate.compare(0, 2, "W/") == 0) {
+                candidate.erase(0, 2);
+            }
+            if (candidate == etag) {
+                return true;
+            }
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
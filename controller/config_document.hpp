@@ -0,0 +1,42 @@
+#ifndef CONFIG_DOCUMENT_HPP
+#define CONFIG_DOCUMENT_HPP
+
+#include "route_table.hpp"
+#include <memory>
+#include <string>
+
+// GET /config body, serialized once per route table snapshot and selected
+// path instead of once per request. Each variant carries its gzip copy and
+// a strong ETag so clients can revalidate with If-None-Match.
+class ConfigDocument {
+public:
+    struct Representation {
+        std::string body;
+        std::string etag;       // quoted, e.g. "\"5c1f...\""
+        std::string gzip;       // body compressed with gzip, empty if compression failed
+        std::string gzip_etag;  // content codings need their own strong ETag
+    };
+
+    static std::shared_ptr<const ConfigDocument> build(std::shared_ptr<const RouteTable> routes, int current_path);
+
+    // True if this document was built from exactly these inputs
+    bool matches(const std::shared_ptr<const RouteTable>& routes, int current_path) const {
+        return routes_ == routes && current_path_ == current_path;
+    }
+
+    const Representation& pretty() const { return pretty_; }    // dump(4), the historical format
+    const Representation& compact() const { return compact_; }
+
+    // If-None-Match check (weak comparison, as RFC 9110 requires for it)
+    static bool etag_matches(const std::string& if_none_match, const std::string& etag);
+
+private:
+    ConfigDocument() = default;
+
+    std::shared_ptr<const RouteTable> routes_;  // held so the identity check cannot be fooled by address reuse
+    int current_path_ = -1;
+    Representation pretty_;
+    Representation compact_;
+};
+
+#endif
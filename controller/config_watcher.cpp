@@ -0,0 +1,161 @@
+#include "config_watcher.hpp"
+#include "logger.hpp"
+#include <chrono>
+#include <filesystem>
+#include <utility>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Editors save with write-in-place or rename-over; wait for the burst to settle
+constexpr int kSettleMs = 100;
+
+std::string directory_of(const std::string& file) {
+    std::string dir = std::filesystem::path(file).parent_path().string();
+    return dir.empty() ? "." : dir;
+}
+
+std::string name_of(const std::string& file) {
+    return std::filesystem::path(file).filename().string();
+}
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(std::string paths_file, std::string components_file, Publish publish)
+    : paths_file_(std::move(paths_file)),
+      components_file_(std::move(components_file)),
+      publish_(std::move(publish)),
+      running_(false),
+      inotify_fd_(-1),
+      wake_fd_(-1) {}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+bool ConfigWatcher::start() {
+    if (running_) {
+        return true;
+    }
+#ifdef __linux__
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0) {
+        Logger::instance().error("Config watcher: failed to initialise inotify");
+        stop();
+        return false;
+    }
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+    std::string paths_dir = directory_of(paths_file_);
+    std::string components_dir = directory_of(components_file_);
+    if (inotify_add_watch(inotify_fd_, paths_dir.c_str(), mask) < 0 ||
+        (components_dir != paths_dir &&
+         inotify_add_watch(inotify_fd_, components_dir.c_str(), mask) < 0)) {
+        Logger::instance().error("Config watcher: failed to watch directory", {{"directory", paths_dir}});
+        stop();
+        return false;
+    }
+#endif
+    running_ = true;
+    worker_ = std::thread(&ConfigWatcher::run, this);
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    if (running_.exchange(false)) {
+#ifdef __linux__
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+#endif
+        worker_.join();
+    }
+#ifdef __linux__
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+#endif
+}
+
+void ConfigWatcher::reload() {
+    std::string error;
+    std::shared_ptr<const RouteTable> table = RouteTable::try_load(paths_file_, components_file_, error);
+    if (!table) {
+        Logger::instance().error("Config watcher: rejected configuration change, keeping current routes: " + error);
+        return;
+    }
+    Logger::instance().info("Config watcher: reloaded route configuration",
+                            {{"path_entries", table->entry_count()}, {"components", table->component_count()}});
+    publish_(std::move(table));
+}
+
+#ifdef __linux__
+
+void ConfigWatcher::run() {
+    const std::string paths_name = name_of(paths_file_);
+    const std::string components_name = name_of(components_file_);
+    alignas(inotify_event) char buffer[4096];
+
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+    bool pending = false;
+    while (running_) {
+        // Block until something happens; once a change is seen, only wait out the settle window
+        int ready = poll(fds, 2, pending ? kSettleMs : -1);
+        if (!running_) {
+            break;
+        }
+        if (ready == 0) {
+            pending = false;
+            reload();
+            continue;
+        }
+        if (ready < 0 || !(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        ssize_t n;
+        while ((n = read(inotify_fd_, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + n;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                if (event->len > 0 && (paths_name == event->name || components_name == event->name)) {
+                    pending = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+#else
+
+void ConfigWatcher::run() {
+    // No inotify: poll modification times
+    auto mtime = [](const std::string& file) {
+        std::error_code ec;
+        return std::filesystem::last_write_time(file, ec);
+    };
+    auto paths_time = mtime(paths_file_);
+    auto components_time = mtime(components_file_);
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        auto p = mtime(paths_file_);
+        auto c = mtime(components_file_);
+        if (p != paths_time || c != components_time) {
+            paths_time = p;
+            components_time = c;
+            std::this_thread::sleep_for(std::chrono::milliseconds(kSettleMs));
+            reload();
+        }
+    }
+}
+
+#endif
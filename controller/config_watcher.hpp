@@ -0,0 +1,38 @@
+#ifndef CONFIG_WATCHER_HPP
+#define CONFIG_WATCHER_HPP
+
+#include "route_table.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Watches paths.json and components_paths.json and hands every valid
+// rebuild of the route table to a publish callback. Runs on its own
+// thread (inotify on Linux, mtime polling elsewhere); invalid files are
+// logged and ignored so the live table stays in place.
+class ConfigWatcher {
+public:
+    using Publish = std::function<void(std::shared_ptr<const RouteTable>)>;
+
+    ConfigWatcher(std::string paths_file, std::string components_file, Publish publish);
+    ~ConfigWatcher();
+
+    bool start();
+    void stop();
+
+private:
+    void run();
+    void reload();
+
+    std::string paths_file_;
+    std::string components_file_;
+    Publish publish_;
+    std::thread worker_;
+    std::atomic<bool> running_;
+    int inotify_fd_;
+    int wake_fd_;
+};
+
+#endif
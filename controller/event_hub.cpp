@@ -0,0 +1,42 @@
+#include "event_hub.hpp"
+#include <algorithm>
+
+EventHub::EventHub(std::size_t history) : history_(history == 0 ? 1 : history), ring_(history_) {}
+
+std::uint64_t EventHub::publish(std::string_view type, std::string_view data) {
+    std::uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = ++last_id_;
+        Event& slot = ring_[(id - 1) % history_];
+        slot.id = id;
+        slot.type.assign(type.data(), type.size());  // keeps the slot's capacity
+        slot.data.assign(data.data(), data.size());
+    }
+    changed_.notify_all();
+    return id;
+}
+
+bool EventHub::wait(std::uint64_t after, std::chrono::milliseconds timeout, std::vector<Event>& out, bool& gap) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!changed_.wait_for(lock, timeout, [&] { return last_id_ > after; })) {
+        return false;
+    }
+    std::uint64_t oldest = last_id_ > history_ ? last_id_ - history_ + 1 : 1;
+    gap = oldest > after + 1;
+    for (std::uint64_t id = std::max(after + 1, oldest); id <= last_id_; ++id) {
+        out.push_back(ring_[(id - 1) % history_]);
+    }
+    return true;
+}
+
+std::uint64_t EventHub::wait_newer(std::uint64_t after, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait_for(lock, timeout, [&] { return last_id_ > after; });
+    return last_id_;
+}
+
+std::uint64_t EventHub::last_id() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_id_;
+}
@@ -0,0 +1,53 @@
+#ifndef EVENT_HUB_HPP
+#define EVENT_HUB_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One change notification: SSE event name plus a compact JSON delta
+struct Event {
+    std::uint64_t id;
+    std::string type;  // "path", "switch", "config"
+    std::string data;
+};
+
+// Fan-out of chassis changes to any number of watchers (GET /events).
+// Publishing appends to a bounded history and wakes every waiter; each
+// watcher keeps its own cursor, so a slow client never holds up the
+// command path or the other clients. The history is a ring of reused
+// slots: once it has wrapped, publishing no longer allocates.
+class EventHub {
+public:
+    explicit EventHub(std::size_t history = 256);
+
+    EventHub(const EventHub&) = delete;
+    EventHub& operator=(const EventHub&) = delete;
+
+    std::uint64_t publish(std::string_view type, std::string_view data);
+
+    // Waits up to timeout for events with id > after and appends them to out.
+    // gap is set when some of them already fell out of the history, in which
+    // case the caller should resend full state. Returns false on timeout.
+    bool wait(std::uint64_t after, std::chrono::milliseconds timeout, std::vector<Event>& out, bool& gap);
+
+    // Waits up to timeout for an event with id > after, without copying
+    // anything out; returns the last id (after on timeout)
+    std::uint64_t wait_newer(std::uint64_t after, std::chrono::milliseconds timeout);
+
+    std::uint64_t last_id() const;
+
+private:
+    const std::size_t history_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Event> ring_;  // event id lives in slot (id - 1) % history_
+    std::uint64_t last_id_ = 0;
+};
+
+#endif
@@ -0,0 +1,460 @@
+#include "event_stream_server.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <utility>
+#ifdef __linux__
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kReadChunk = 4096;
+
+// A client whose request head grows past this is dropped
+constexpr std::size_t kMaxRequestHead = 8 * 1024;
+
+// A watcher this far behind is dropped; it reconnects with Last-Event-ID
+constexpr std::size_t kMaxPendingOutput = 1024 * 1024;
+
+// Comment line sent to idle streams, which also finds clients that went away
+constexpr std::chrono::seconds kKeepAliveInterval(15);
+
+constexpr std::string_view kStreamHead =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n";
+
+constexpr std::string_view kNotFound =
+    "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+constexpr std::string_view kMethodNotAllowed =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return (x | 0x20) == (y | 0x20);
+    });
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+} // namespace
+
+EventStreamServer::EventStreamServer(EventHub& hub, StateFrame state_frame)
+    : hub_(hub), state_frame_(std::move(state_frame)), listen_fd_(-1), epoll_fd_(-1), wake_fd_(-1), port_(0),
+      running_(false) {}
+
+EventStreamServer::~EventStreamServer() {
+    stop();
+}
+
+void EventStreamServer::append_frame(std::string& out, std::uint64_t id, std::string_view type,
+                                     std::string_view data) {
+    char digits[20];
+    auto end = std::to_chars(digits, digits + sizeof(digits), id).ptr;
+    out += "id: ";
+    out.append(digits, static_cast<std::size_t>(end - digits));
+    out += "\nevent: ";
+    out += type;
+    out += "\ndata: ";
+    out += data;
+    out += "\n\n";
+}
+
+#ifndef __linux__
+
+bool EventStreamServer::listen_tcp(const std::string&, int) {
+    Logger::instance().warn("Event stream server needs epoll and is only available on Linux");
+    return false;
+}
+
+void EventStreamServer::stop() {}
+void EventStreamServer::run() {}
+void EventStreamServer::watch_hub() {}
+void EventStreamServer::accept_clients() {}
+void EventStreamServer::receive(Session&) {}
+void EventStreamServer::start_stream(Session&, const std::string&) {}
+void EventStreamServer::fan_out() {}
+void EventStreamServer::keep_alive() {}
+bool EventStreamServer::flush(Session&) { return false; }
+void EventStreamServer::update_interest(Session&) {}
+void EventStreamServer::close_session(int) {}
+
+#else
+
+bool EventStreamServer::listen_tcp(const std::string& host, int port) {
+    if (running_) {
+        Logger::instance().warn("Event stream server is already listening");
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        Logger::instance().error("Event stream server: cannot resolve host", {{"host", host}});
+        return false;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, result->ai_protocol);
+    int one = 1;
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (fd < 0 || bind(fd, result->ai_addr, result->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+        Logger::instance().error("Event stream server: cannot listen", {{"host", host}, {"port", port},
+                                                                        {"error", std::strerror(errno)}});
+        if (fd >= 0) {
+            close(fd);
+        }
+        freeaddrinfo(result);
+        return false;
+    }
+    freeaddrinfo(result);
+
+    sockaddr_in bound{};
+    socklen_t length = sizeof(bound);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&bound), &length);
+    port_ = ntohs(bound.sin_port);
+
+    listen_fd_ = fd;
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    cursor_ = hub_.last_id();
+    next_keep_alive_ = Clock::now() + kKeepAliveInterval;
+    running_ = true;
+    loop_ = std::thread(&EventStreamServer::run, this);
+    watcher_ = std::thread(&EventStreamServer::watch_hub, this);
+    Logger::instance().info("Event stream server listening", {{"host", host}, {"port", port_}});
+    return true;
+}
+
+void EventStreamServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    loop_.join();
+    watcher_.join();
+
+    for (auto& entry : sessions_) {
+        close(entry.first);
+    }
+    sessions_.clear();
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+}
+
+// Turns EventHub's condition variable into a wakeup of the epoll loop. The
+// short wait only bounds how long stop() takes.
+void EventStreamServer::watch_hub() {
+    std::uint64_t seen = hub_.last_id();
+    while (running_) {
+        std::uint64_t last = hub_.wait_newer(seen, std::chrono::seconds(1));
+        if (last != seen) {
+            seen = last;
+            uint64_t one = 1;
+            ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+}
+
+void EventStreamServer::run() {
+    epoll_event events[64];
+    while (running_) {
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_keep_alive_ - Clock::now()).count();
+        int n = epoll_wait(epoll_fd_, events, 64, static_cast<int>(std::max<long long>(wait + 1, 0)));
+        if (n < 0 && errno != EINTR) {
+            Logger::instance().error("Event stream server: epoll_wait failed", {{"error", std::strerror(errno)}});
+            break;
+        }
+        bool published = false;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t count;
+                ssize_t ignored = read(wake_fd_, &count, sizeof(count));
+                (void)ignored;
+                published = true;
+                continue;
+            }
+            if (fd == listen_fd_) {
+                accept_clients();
+                continue;
+            }
+            auto it = sessions_.find(fd);
+            if (it == sessions_.end()) {
+                continue;
+            }
+            Session& session = *it->second;
+            if ((events[i].events & EPOLLOUT) && !flush(session)) {
+                close_session(fd);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                receive(session);  // may close the session
+            }
+        }
+        if (published) {
+            fan_out();
+        }
+        if (Clock::now() >= next_keep_alive_) {
+            keep_alive();
+            next_keep_alive_ = Clock::now() + kKeepAliveInterval;
+        }
+    }
+}
+
+void EventStreamServer::accept_clients() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;  // EAGAIN: backlog drained
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto session = std::make_unique<Session>();
+        session->fd = fd;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        sessions_[fd] = std::move(session);
+    }
+}
+
+void EventStreamServer::receive(Session& session) {
+    const int fd = session.fd;
+    char buffer[kReadChunk];
+    bool closed = false;
+    while (true) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            if (!session.streaming && !session.closing) {
+                session.rx.append(buffer, static_cast<std::size_t>(n));
+            }
+            continue;  // a streaming client has nothing more to say; drained and ignored
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        closed = n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+    if (closed || session.rx.size() > kMaxRequestHead) {
+        close_session(fd);
+        return;
+    }
+    if (session.streaming || session.closing) {
+        return;
+    }
+
+    std::size_t head_end = session.rx.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        head_end = session.rx.find("\n\n");
+        if (head_end == std::string::npos) {
+            return;  // wait for the rest of the head
+        }
+    }
+    std::string_view head(session.rx.data(), head_end);
+
+    // Request line: GET /events[?...] HTTP/1.1
+    std::string_view line = head.substr(0, head.find('\n'));
+    std::string_view method = line.substr(0, line.find(' '));
+    std::string_view target = line.size() > method.size() ? line.substr(method.size() + 1) : std::string_view();
+    target = target.substr(0, target.find(' '));
+    std::string_view path = target.substr(0, target.find('?'));
+
+    std::string last_event_id;
+    for (std::size_t start = line.size() + 1; start < head.size();) {
+        std::size_t end = std::min(head.find('\n', start), head.size());
+        std::string_view header = head.substr(start, end - start);
+        std::size_t colon = header.find(':');
+        if (colon != std::string_view::npos && equals_ignore_case(trim(header.substr(0, colon)), "Last-Event-ID")) {
+            last_event_id = std::string(trim(header.substr(colon + 1)));
+        }
+        start = end + 1;
+    }
+
+    if (path != "/events") {
+        session.tx.assign(kNotFound);
+        session.closing = true;
+    } else if (method != "GET") {
+        session.tx.assign(kMethodNotAllowed);
+        session.closing = true;
+    } else {
+        start_stream(session, last_event_id);
+    }
+    session.rx.clear();
+    session.rx.shrink_to_fit();
+    if (!flush(session)) {
+        close_session(fd);
+    }
+}
+
+// Cursor and state follow the order of the HTTP handler: a change racing
+// with the connect is sent twice rather than lost
+void EventStreamServer::start_stream(Session& session, const std::string& last_event_id) {
+    fan_out();  // bring the others up to date first, so cursor_ is current
+
+    session.tx.assign(kStreamHead);
+    std::uint64_t resume_from = 0;
+    const char* first = last_event_id.data();
+    const char* last = first + last_event_id.size();
+    auto parsed = std::from_chars(first, last, resume_from);
+    bool resume = !last_event_id.empty() && parsed.ec == std::errc() && parsed.ptr == last && resume_from <= cursor_;
+
+    bool gap = false;
+    batch_.clear();
+    if (!resume) {
+        session.tx += state_frame_(cursor_);
+    } else if (hub_.wait(resume_from, std::chrono::milliseconds(0), batch_, gap)) {
+        if (gap) {
+            session.tx += state_frame_(cursor_);
+        } else {
+            for (const Event& event : batch_) {
+                if (event.id <= cursor_) {  // later ones come with the next fan_out()
+                    append_frame(session.tx, event.id, event.type, event.data);
+                }
+            }
+        }
+    }
+    session.streaming = true;
+    Logger::instance().debug("Event stream opened", {{"fd", session.fd}, {"sessions", sessions_.size()}});
+}
+
+// Formats the new events once and queues them on every stream
+void EventStreamServer::fan_out() {
+    bool gap = false;
+    batch_.clear();
+    if (!hub_.wait(cursor_, std::chrono::milliseconds(0), batch_, gap)) {
+        return;
+    }
+    frames_.clear();
+    if (gap) {
+        cursor_ = batch_.back().id;
+        frames_ = state_frame_(cursor_);
+    } else {
+        for (const Event& event : batch_) {
+            append_frame(frames_, event.id, event.type, event.data);
+        }
+        cursor_ = batch_.back().id;
+    }
+
+    std::vector<int> dropped;
+    for (auto& entry : sessions_) {
+        Session& session = *entry.second;
+        if (!session.streaming) {
+            continue;
+        }
+        session.tx += frames_;
+        if (session.tx.size() - session.tx_offset > kMaxPendingOutput) {
+            Logger::instance().warn("Event stream client is not reading, closing", {{"fd", session.fd}});
+            dropped.push_back(entry.first);
+        } else if (!flush(session)) {
+            dropped.push_back(entry.first);
+        }
+    }
+    for (int fd : dropped) {
+        close_session(fd);
+    }
+}
+
+void EventStreamServer::keep_alive() {
+    std::vector<int> dropped;
+    for (auto& entry : sessions_) {
+        Session& session = *entry.second;
+        if (session.streaming && session.tx_offset == session.tx.size()) {
+            session.tx += ": keep-alive\n\n";
+            if (!flush(session)) {
+                dropped.push_back(entry.first);
+            }
+        }
+    }
+    for (int fd : dropped) {
+        close_session(fd);
+    }
+}
+
+// false when the session is done: a send error, or an error reply fully sent
+bool EventStreamServer::flush(Session& session) {
+    while (session.tx_offset < session.tx.size()) {
+        ssize_t n = send(session.fd, session.tx.data() + session.tx_offset,
+                         session.tx.size() - session.tx_offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        session.tx_offset += static_cast<std::size_t>(n);
+    }
+    if (session.tx_offset == session.tx.size()) {
+        session.tx.clear();
+        session.tx_offset = 0;
+        if (session.closing) {
+            return false;
+        }
+    }
+    update_interest(session);
+    return true;
+}
+
+void EventStreamServer::update_interest(Session& session) {
+    bool want_write = session.tx_offset < session.tx.size();
+    if (want_write == session.want_write) {
+        return;
+    }
+    session.want_write = want_write;
+    epoll_event ev{};
+    ev.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.fd = session.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session.fd, &ev);
+}
+
+void EventStreamServer::close_session(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    sessions_.erase(fd);
+    Logger::instance().debug("Event stream closed", {{"fd", fd}, {"sessions", sessions_.size()}});
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef EVENT_STREAM_SERVER_HPP
+#define EVENT_STREAM_SERVER_HPP
+
+#include "event_hub.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// GET /events (Server-Sent Events) on a port of its own, so watchers do not
+// hold HTTP worker threads: one epoll thread owns every stream socket and
+// writes each change to all of them (Linux only; listen fails elsewhere).
+// It speaks just enough HTTP/1.1 for EventSource and curl: a GET of
+// /events, an optional Last-Event-ID header, then a text/event-stream body
+// that lasts as long as the connection.
+class EventStreamServer {
+public:
+    // Full state frame, sent on connect and after a gap in the history
+    using StateFrame = std::function<std::string(std::uint64_t id)>;
+
+    EventStreamServer(EventHub& hub, StateFrame state_frame);
+    ~EventStreamServer();
+
+    EventStreamServer(const EventStreamServer&) = delete;
+    EventStreamServer& operator=(const EventStreamServer&) = delete;
+
+    bool listen_tcp(const std::string& host, int port);
+    void stop();
+
+    // Port being served, 0 when not listening
+    int port() const { return running_ ? port_ : 0; }
+
+    // "id: N\nevent: TYPE\ndata: DATA\n\n"
+    static void append_frame(std::string& out, std::uint64_t id, std::string_view type, std::string_view data);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Session {
+        int fd = -1;
+        std::string rx;            // request head, until the stream starts
+        std::string tx;
+        std::size_t tx_offset = 0;
+        bool streaming = false;    // response head sent, receives every event
+        bool closing = false;      // close once tx is flushed (error replies)
+        bool want_write = false;   // EPOLLOUT registered
+    };
+
+    void run();
+    void watch_hub();
+    void accept_clients();
+    void receive(Session& session);
+    void start_stream(Session& session, const std::string& last_event_id);
+    void fan_out();
+    void keep_alive();
+    bool flush(Session& session);
+    void update_interest(Session& session);
+    void close_session(int fd);
+
+    EventHub& hub_;
+    StateFrame state_frame_;
+    int listen_fd_;
+    int epoll_fd_;
+    int wake_fd_;   // written by watch_hub() when events are published
+    int port_;
+    std::atomic<bool> running_;
+    std::thread loop_;
+    std::thread watcher_;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions_;
+
+    // Loop thread only
+    std::uint64_t cursor_ = 0;     // last event written to the streams
+    std::vector<Event> batch_;
+    std::string frames_;
+    Clock::time_point next_keep_alive_;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "http_settings.hpp"
+#include "logger.hpp"
+#include "ring_task_queue.hpp"
+#include <httplib.h>
+#include <cerrno>
+#include <cstdlib>
+
+namespace {
+
+struct Option {
+    const char* flag;
+    const char* env;
+    std::size_t HttpSettings::*field;
+    std::size_t min;
+};
+
+const Option kOptions[] = {
+    {"--http-threads", "SFP_HTTP_THREADS", &HttpSettings::threads, 0},
+    {"--http-max-queued", "SFP_HTTP_MAX_QUEUED", &HttpSettings::max_queued, 0},
+    {"--http-keep-alive-s", "SFP_HTTP_KEEP_ALIVE_S", &HttpSettings::keep_alive_s, 1},
+    {"--http-keep-alive-max", "SFP_HTTP_KEEP_ALIVE_MAX", &HttpSettings::keep_alive_max, 1},
+    {"--http-read-timeout-ms", "SFP_HTTP_READ_TIMEOUT_MS", &HttpSettings::read_timeout_ms, 1},
+    {"--http-write-timeout-ms", "SFP_HTTP_WRITE_TIMEOUT_MS", &HttpSettings::write_timeout_ms, 1},
+    {"--http-payload-max", "SFP_HTTP_PAYLOAD_MAX", &HttpSettings::payload_max, 0},
+};
+
+bool parse_queue(const char* text, bool& ring_queue) {
+    std::string name = text != nullptr ? text : "";
+    if (name != "pool" && name != "ring") {
+        return false;
+    }
+    ring_queue = name == "ring";
+    return true;
+}
+
+bool parse_size(const char* text, std::size_t min, std::size_t& value) {
+    if (text == nullptr || *text < '0' || *text > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < min) {
+        return false;
+    }
+    value = static_cast<std::size_t>(parsed);
+    return true;
+}
+
+} // namespace
+
+void HttpSettings::load_environment() {
+    for (const Option& option : kOptions) {
+        const char* text = std::getenv(option.env);
+        if (text != nullptr && !parse_size(text, option.min, this->*option.field)) {
+            Logger::instance().warn("Ignoring invalid HTTP setting", {{"name", option.env}, {"value", text}});
+        }
+    }
+    const char* queue = std::getenv("SFP_HTTP_QUEUE");
+    if (queue != nullptr && !parse_queue(queue, ring_queue)) {
+        Logger::instance().warn("Ignoring invalid HTTP setting", {{"name", "SFP_HTTP_QUEUE"}, {"value", queue}});
+    }
+}
+
+bool HttpSettings::parse_arguments(int argc, char** argv, std::string& error) {
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--http-queue") {
+            if (i + 1 >= argc || !parse_queue(argv[i + 1], ring_queue)) {
+                error = "--http-queue is pool or ring";
+                return false;
+            }
+            ++i;
+            continue;
+        }
+        const Option* match = nullptr;
+        for (const Option& option : kOptions) {
+            if (flag == option.flag) {
+                match = &option;
+            }
+        }
+        if (match == nullptr) {
+            error = "unknown option " + flag;
+            return false;
+        }
+        if (i + 1 >= argc || !parse_size(argv[i + 1], match->min, this->*match->field)) {
+            error = flag + " needs a number" + (match->min > 0 ? " of at least " + std::to_string(match->min) : "");
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+std::size_t HttpSettings::worker_count() const {
+    return threads > 0 ? threads : static_cast<std::size_t>(CPPHTTPLIB_THREAD_POOL_COUNT);
+}
+
+void HttpSettings::apply(httplib::Server& server) const {
+    std::size_t workers = worker_count();
+    std::size_t queued = max_queued;
+    if (ring_queue) {
+        server.new_task_queue = [workers, queued] { return new RingTaskQueue(workers, queued); };
+    } else {
+        server.new_task_queue = [workers, queued] { return new httplib::ThreadPool(workers, queued); };
+    }
+    server.set_keep_alive_timeout(static_cast<time_t>(keep_alive_s));
+    server.set_keep_alive_max_count(keep_alive_max);
+    server.set_read_timeout(std::chrono::milliseconds(read_timeout_ms));
+    server.set_write_timeout(std::chrono::milliseconds(write_timeout_ms));
+    if (payload_max > 0) {
+        server.set_payload_max_length(payload_max);
+    }
+}
+
+std::string HttpSettings::usage() {
+    std::string text = "Options (or the environment variable):\n";
+    for (const Option& option : kOptions) {
+        std::string flag = std::string(option.flag) + " N";
+        text += "  " + flag + std::string(flag.size() < 28 ? 28 - flag.size() : 1, ' ') + option.env + "\n";
+    }
+    text += "  --http-queue pool|ring      SFP_HTTP_QUEUE\n";
+    return text;
+}
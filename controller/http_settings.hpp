@@ -0,0 +1,52 @@
+#ifndef HTTP_SETTINGS_HPP
+#define HTTP_SETTINGS_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace httplib {
+class Server;
+}
+
+// Sizing of the HTTP front end, which httplib otherwise fixes at compile
+// time (CPPHTTPLIB_THREAD_POOL_COUNT workers, 5 s keep-alive, 100 requests
+// per connection). Read from SFP_HTTP_* environment variables, then from
+// command line flags, which win:
+//
+//   --http-threads N          SFP_HTTP_THREADS           worker threads (0: httplib default)
+//   --http-max-queued N       SFP_HTTP_MAX_QUEUED        connections waiting for a worker
+//                                                        before new ones are refused (0: no limit)
+//   --http-keep-alive-s N     SFP_HTTP_KEEP_ALIVE_S      idle keep-alive timeout
+//   --http-keep-alive-max N   SFP_HTTP_KEEP_ALIVE_MAX    requests per connection
+//   --http-read-timeout-ms N  SFP_HTTP_READ_TIMEOUT_MS
+//   --http-write-timeout-ms N SFP_HTTP_WRITE_TIMEOUT_MS
+//   --http-payload-max N      SFP_HTTP_PAYLOAD_MAX       largest request body in bytes (0: no limit)
+//   --http-queue pool|ring    SFP_HTTP_QUEUE             httplib::ThreadPool (default) or
+//                                                        RingTaskQueue
+struct HttpSettings {
+    std::size_t threads = 0;
+    std::size_t max_queued = 0;
+    std::size_t keep_alive_s = 5;
+    std::size_t keep_alive_max = 100;
+    std::size_t read_timeout_ms = 5000;
+    std::size_t write_timeout_ms = 5000;
+    std::size_t payload_max = 0;
+    bool ring_queue = false;
+
+    // Invalid environment values are logged and skipped
+    void load_environment();
+
+    // false with error set on an unknown flag or a bad value
+    bool parse_arguments(int argc, char** argv, std::string& error);
+
+    std::size_t worker_count() const;  // threads, or httplib's default for 0
+
+    const char* queue_name() const { return ring_queue ? "ring" : "pool"; }
+
+    // Installs the task queue and the limits; call before listen()
+    void apply(httplib::Server& server) const;
+
+    static std::string usage();
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+// Streaming JSON output for the command replies. Writes straight into a
+// caller-owned std::string (cleared, capacity kept), so a thread-local
+// buffer makes every reply after the first allocation free. Keys are
+// quoted at compile time with json_key(); numbers go through to_chars.
+//
+//   static constexpr auto kStatus = json_key("status");
+//   JsonWriter json(buffer);
+//   json.begin_object();
+//   json.key(kStatus).value("OK");
+//   json.end_object();
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// "name": with quotes and colon, ready to append
+template <std::size_t N>
+struct JsonKey {
+    char text[N + 3] = {};
+
+    constexpr std::string_view view() const { return std::string_view(text, N + 3); }
+};
+
+template <std::size_t N>
+constexpr JsonKey<N - 1> json_key(const char (&name)[N]) {
+    JsonKey<N - 1> key;
+    key.text[0] = '"';
+    for (std::size_t i = 0; i + 1 < N; ++i) {
+        if (name[i] == '"' || name[i] == '\\' || static_cast<unsigned char>(name[i]) < 0x20) {
+            throw "json_key: key would need escaping";
+        }
+        key.text[i + 1] = name[i];
+    }
+    key.text[N] = '"';
+    key.text[N + 1] = ':';
+    return key;
+}
+
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) { out_.clear(); }
+
+    JsonWriter& begin_object() { separate(); out_ += '{'; need_comma_ = false; return *this; }
+    JsonWriter& end_object() { out_ += '}'; need_comma_ = true; return *this; }
+    JsonWriter& begin_array() { separate(); out_ += '['; need_comma_ = false; return *this; }
+    JsonWriter& end_array() { out_ += ']'; need_comma_ = true; return *this; }
+
+    template <std::size_t N>
+    JsonWriter& key(const JsonKey<N>& name) {
+        separate();
+        out_ += name.view();
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separate();
+        out_ += '"';
+        escape(text);
+        out_ += '"';
+        return *this;
+    }
+
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+
+    // One string value from several pieces, e.g. {"Component ", id, " not found"}
+    JsonWriter& concat(std::initializer_list<std::string_view> parts) {
+        separate();
+        out_ += '"';
+        for (std::string_view part : parts) {
+            escape(part);
+        }
+        out_ += '"';
+        return *this;
+    }
+
+    JsonWriter& value(bool flag) {
+        separate();
+        out_ += flag ? "true" : "false";
+        return *this;
+    }
+
+    JsonWriter& value(int number) { return integer(number); }
+    JsonWriter& value(long number) { return integer(number); }
+    JsonWriter& value(long long number) { return integer(number); }
+    JsonWriter& value(unsigned number) { return integer(number); }
+    JsonWriter& value(unsigned long number) { return integer(number); }
+    JsonWriter& value(unsigned long long number) { return integer(number); }
+
+    // Already serialized JSON, e.g. a document rendered once at load time
+    JsonWriter& raw(std::string_view json) {
+        separate();
+        out_ += json;
+        return *this;
+    }
+
+private:
+    void separate() {
+        if (need_comma_) {
+            out_ += ',';
+        }
+        need_comma_ = true;
+    }
+
+    template <typename Int>
+    JsonWriter& integer(Int number) {
+        separate();
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        out_.append(digits, static_cast<std::size_t>(result.ptr - digits));
+        return *this;
+    }
+
+    void escape(std::string_view text) {
+        static constexpr char kHex[] = "0123456789abcdef";
+        std::size_t clean = 0;  // start of the run that needs no escaping
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out_.append(text.data() + clean, i - clean);
+            clean = i + 1;
+            switch (c) {
+            case '"': out_ += "\\\""; break;
+            case '\\': out_ += "\\\\"; break;
+            case '\n': out_ += "\\n"; break;
+            case '\r': out_ += "\\r"; break;
+            case '\t': out_ += "\\t"; break;
+            case '\b': out_ += "\\b"; break;
+            case '\f': out_ += "\\f"; break;
+            default:
+                out_ += "\\u00";
+                out_ += kHex[c >> 4];
+                out_ += kHex[c & 0xf];
+                break;
+            }
+        }
+        out_.append(text.data() + clean, text.size() - clean);
+    }
+
+    std::string& out_;
+    bool need_comma_ = false;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "latency_histograms.hpp"
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+namespace {
+
+std::atomic<std::uint64_t> next_instance_id(1);
+
+struct CachedShard {
+    std::uint64_t owner;
+    void* shard;
+    std::weak_ptr<void> pool;
+    void (*release)(void* pool, void* shard);
+};
+
+// Shards this thread holds, by instance; almost always one entry. Handed
+// back when the thread exits.
+struct ThreadShards {
+    std::vector<CachedShard> cached;
+
+    ~ThreadShards() {
+        for (const CachedShard& entry : cached) {
+            if (std::shared_ptr<void> pool = entry.pool.lock()) {
+                entry.release(pool.get(), entry.shard);
+            }
+        }
+    }
+};
+
+thread_local ThreadShards thread_shards;
+
+// Counters have a single writer, so a plain load/store pair is enough and
+// avoids the locked read-modify-write of fetch_add
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+void append_number(std::string& out, double value) {
+    if (std::isnan(value)) {
+        out += "NaN";
+        return;
+    }
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%.9g", value);
+    out.append(text, static_cast<std::size_t>(length));
+}
+
+} // namespace
+
+LatencyHistograms::Shard::Shard(std::size_t stages) : histograms(new Histogram[stages]) {
+    for (std::size_t stage = 0; stage < stages; ++stage) {
+        for (auto& bucket : histograms[stage].buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histograms[stage].sum_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistograms::LatencyHistograms(std::vector<std::string> stages)
+    : stages_(std::move(stages)), id_(next_instance_id.fetch_add(1)), pool_(std::make_shared<ShardPool>()) {}
+
+std::size_t LatencyHistograms::bucket_index(std::uint64_t ns) {
+    if (ns < kSubBuckets) {
+        return static_cast<std::size_t>(ns);
+    }
+    if (ns >= (std::uint64_t(1) << kMaxBits)) {
+        return kBuckets - 1;
+    }
+    int top = 63 - __builtin_clzll(ns);  // >= kSubBits
+    std::uint64_t sub = (ns >> (top - kSubBits)) & (kSubBuckets - 1);
+    return static_cast<std::size_t>((top - kSubBits + 1) * kSubBuckets + sub);
+}
+
+double LatencyHistograms::bucket_value(std::size_t index) {
+    if (index < kSubBuckets) {
+        return static_cast<double>(index);
+    }
+    std::size_t group = index / kSubBuckets;
+    std::uint64_t sub = index % kSubBuckets;
+    std::uint64_t width = std::uint64_t(1) << (group - 1);
+    std::uint64_t lower = (kSubBuckets + sub) << (group - 1);
+    return static_cast<double>(lower) + static_cast<double>(width - 1) / 2;
+}
+
+LatencyHistograms::Shard& LatencyHistograms::local_shard() {
+    for (const CachedShard& cached : thread_shards.cached) {
+        if (cached.owner == id_) {
+            return *static_cast<Shard*>(cached.shard);
+        }
+    }
+    // First record from this thread: reuse the shard of a thread that has
+    // exited, or add one. Shards stay with the instance, so counts survive
+    // the thread.
+    Shard* shard;
+    {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        if (!pool_->free.empty()) {
+            shard = pool_->free.back();
+            pool_->free.pop_back();
+        } else {
+            pool_->shards.push_back(std::make_unique<Shard>(stages_.size()));
+            shard = pool_->shards.back().get();
+        }
+    }
+    thread_shards.cached.push_back({id_, shard, pool_, &LatencyHistograms::release});
+    return *shard;
+}
+
+void LatencyHistograms::release(void* pool, void* shard) {
+    ShardPool& shards = *static_cast<ShardPool*>(pool);
+    std::lock_guard<std::mutex> lock(shards.mutex);
+    shards.free.push_back(static_cast<Shard*>(shard));
+}
+
+void LatencyHistograms::record(int stage, Clock::duration elapsed) {
+    if (stage < 0 || static_cast<std::size_t>(stage) >= stages_.size()) {
+        return;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::uint64_t value = ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+    Histogram& histogram = local_shard().histograms[static_cast<std::size_t>(stage)];
+    bump(histogram.buckets[bucket_index(value)], 1);
+    bump(histogram.sum_ns, value);
+}
+
+LatencyHistograms::Summary LatencyHistograms::summary(int stage) const {
+    Summary summary;
+    if (stage < 0 || static_cast<std::size_t>(stage) >= stages_.size()) {
+        return summary;
+    }
+    std::vector<std::uint64_t> counts(kBuckets);
+    std::uint64_t sum_ns = 0;
+    {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        for (const auto& shard : pool_->shards) {
+            const Histogram& histogram = shard->histograms[static_cast<std::size_t>(stage)];
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                counts[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+            }
+            sum_ns += histogram.sum_ns.load(std::memory_order_relaxed);
+        }
+    }
+    for (std::uint64_t count : counts) {
+        summary.count += count;
+    }
+    summary.sum_seconds = static_cast<double>(sum_ns) * 1e-9;
+    if (summary.count == 0) {
+        summary.p50_seconds = summary.p99_seconds = summary.p999_seconds = std::nan("");
+        return summary;
+    }
+
+    // Smallest bucket whose cumulative count reaches each rank
+    const double quantiles[] = {0.5, 0.99, 0.999};
+    double* results[] = {&summary.p50_seconds, &summary.p99_seconds, &summary.p999_seconds};
+    std::size_t next = 0;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets && next < 3; ++i) {
+        seen += counts[i];
+        while (next < 3 && static_cast<double>(seen) >= std::ceil(quantiles[next] * static_cast<double>(summary.count))) {
+            *results[next++] = bucket_value(i) * 1e-9;
+        }
+    }
+    return summary;
+}
+
+void LatencyHistograms::write_prometheus(std::string& out, std::string_view metric, std::string_view help) const {
+    out.append("# HELP ").append(metric).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(metric).append(" summary\n");
+    for (std::size_t stage = 0; stage < stages_.size(); ++stage) {
+        Summary summary = this->summary(static_cast<int>(stage));
+        const std::pair<const char*, double> quantiles[] = {
+            {"0.5", summary.p50_seconds}, {"0.99", summary.p99_seconds}, {"0.999", summary.p999_seconds}};
+        for (const auto& quantile : quantiles) {
+            out.append(metric).append("{stage=\"").append(stages_[stage]).append("\",quantile=\"");
+            out.append(quantile.first).append("\"} ");
+            append_number(out, quantile.second);
+            out += '\n';
+        }
+        out.append(metric).append("_sum{stage=\"").append(stages_[stage]).append("\"} ");
+        append_number(out, summary.sum_seconds);
+        out += '\n';
+        out.append(metric).append("_count{stage=\"").append(stages_[stage]).append("\"} ");
+        out.append(std::to_string(summary.count));
+        out += '\n';
+    }
+}
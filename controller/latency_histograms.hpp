@@ -0,0 +1,104 @@
+#ifndef LATENCY_HISTOGRAMS_HPP
+#define LATENCY_HISTOGRAMS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Latency histograms for named stages of the command path, exported as a
+// Prometheus summary (GET /metrics).
+//
+// Buckets are HDR style: exact below 32 ns, then 32 linear sub-buckets per
+// power of two, so any recorded value is within about 3% of its bucket.
+// Every thread records into its own shard, which only that thread writes,
+// so record() is two uncontended relaxed stores; a Scope adds two clock
+// reads, one when it starts and one when it ends. Readers add the shards
+// up; a reader racing a writer sees a count a moment early or late, never
+// a torn one. A thread that exits hands its shard, counts and all, to the
+// next thread that starts recording, so there are only ever as many shards
+// as threads that recorded at the same time.
+class LatencyHistograms {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LatencyHistograms(std::vector<std::string> stages);
+
+    LatencyHistograms(const LatencyHistograms&) = delete;
+    LatencyHistograms& operator=(const LatencyHistograms&) = delete;
+
+    void record(int stage, Clock::duration elapsed);
+
+    // Times the enclosing block into stage
+    class Scope {
+    public:
+        Scope(LatencyHistograms& histograms, int stage)
+            : histograms_(histograms), stage_(stage), started_(Clock::now()) {}
+        ~Scope() { histograms_.record(stage_, Clock::now() - started_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LatencyHistograms& histograms_;
+        int stage_;
+        Clock::time_point started_;
+    };
+
+    struct Summary {
+        std::uint64_t count = 0;
+        double sum_seconds = 0;
+        double p50_seconds = 0;
+        double p99_seconds = 0;
+        double p999_seconds = 0;
+    };
+
+    Summary summary(int stage) const;
+
+    // Prometheus text exposition: one summary metric labelled by stage
+    void write_prometheus(std::string& out, std::string_view metric, std::string_view help) const;
+
+    const std::vector<std::string>& stages() const { return stages_; }
+
+private:
+    static constexpr int kSubBits = 5;
+    static constexpr std::uint64_t kSubBuckets = 1u << kSubBits;
+    static constexpr int kMaxBits = 40;  // ~18 minutes in ns; longer values land in the last bucket
+    static constexpr std::size_t kBuckets = (kMaxBits - kSubBits + 1) * kSubBuckets;
+
+    struct Histogram {
+        std::array<std::atomic<std::uint64_t>, kBuckets> buckets;
+        std::atomic<std::uint64_t> sum_ns;
+    };
+
+    struct Shard {
+        explicit Shard(std::size_t stages);
+        std::unique_ptr<Histogram[]> histograms;
+    };
+
+    // Shared with the thread caches, whose destructors release into it even
+    // if they run after the instance is gone
+    struct ShardPool {
+        std::mutex mutex;  // registration, release and readers only
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<Shard*> free;  // shards of threads that have exited
+    };
+
+    static std::size_t bucket_index(std::uint64_t ns);
+    static double bucket_value(std::size_t index);  // midpoint, in ns
+
+    Shard& local_shard();
+    static void release(void* pool, void* shard);  // at thread exit
+
+    const std::vector<std::string> stages_;
+    const std::uint64_t id_;  // tells thread caches of different instances apart
+    const std::shared_ptr<ShardPool> pool_;
+};
+
+#endif
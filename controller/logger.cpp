@@ -0,0 +1,206 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Quiet ring: how long the drain thread sleeps before looking again
+constexpr auto kIdleWait = std::chrono::milliseconds(5);
+
+void append_text(std::string& out, const char* text, std::size_t length) {
+    bool quote = std::find(text, text + length, ' ') != text + length;
+    if (quote) {
+        out += '"';
+    }
+    out.append(text, length);
+    if (quote) {
+        out += '"';
+    }
+}
+
+} // namespace
+
+Logger::Logger()
+    : ring_(new Record[kCapacity]),
+      enqueue_pos_(0),
+      dequeue_pos_(0),
+      threshold_(LogLevel::Info),
+      dropped_(0),
+      written_(0),
+      running_(true) {
+    for (std::size_t i = 0; i < kCapacity; ++i) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker_ = std::thread(&Logger::drain, this);
+}
+
+Logger::~Logger() {
+    running_ = false;
+    wake_.notify_one();
+    worker_.join();
+}
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+void Logger::log(LogLevel level, std::string_view msg, LogFields fields) {
+    if (!enabled(level) || level == LogLevel::Off) {
+        return;
+    }
+
+    // Claim a slot (bounded MPMC ring, Vyukov style, with a single consumer)
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Record* record;
+    for (;;) {
+        record = &ring_[pos & (kCapacity - 1)];
+        std::size_t sequence = record->sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->level = level;
+    record->message_length = static_cast<std::uint16_t>(std::min(msg.size(), kMessageCapacity));
+    std::memcpy(record->message, msg.data(), record->message_length);
+
+    std::size_t count = 0;
+    for (const LogField& field : fields) {
+        if (count == kMaxFields) {
+            break;
+        }
+        StoredField& stored = record->fields[count++];
+        stored.key = field.key;
+        stored.type = field.type;
+        if (field.type == LogField::Type::Text) {
+            stored.text_length = static_cast<std::uint8_t>(std::min(field.text.size(), LogField::kTextCapacity));
+            std::memcpy(stored.text, field.text.data(), stored.text_length);
+        } else {
+            stored.u = field.u;
+        }
+    }
+    record->field_count = static_cast<std::uint8_t>(count);
+
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool Logger::write_pending() {
+    std::string out;
+    std::string err;
+    std::size_t count = 0;
+
+    for (;;) {
+        Record& record = ring_[dequeue_pos_ & (kCapacity - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+            break;
+        }
+
+        std::string& line = record.level >= LogLevel::Warn ? err : out;
+        line += '[';
+        line += level_name(record.level);
+        line += "] ";
+        line.append(record.message, record.message_length);
+        for (std::size_t i = 0; i < record.field_count; ++i) {
+            const StoredField& field = record.fields[i];
+            line += ' ';
+            line += field.key;
+            line += '=';
+            char number[32];
+            switch (field.type) {
+            case LogField::Type::Int:
+                std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(field.i));
+                line += number;
+                break;
+            case LogField::Type::Uint:
+                std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(field.u));
+                line += number;
+                break;
+            case LogField::Type::Double:
+                std::snprintf(number, sizeof(number), "%.3f", field.d);
+                line += number;
+                break;
+            case LogField::Type::Text:
+                append_text(line, field.text, field.text_length);
+                break;
+            }
+        }
+        line += '\n';
+
+        record.sequence.store(dequeue_pos_ + kCapacity, std::memory_order_release);
+        ++dequeue_pos_;
+        ++count;
+    }
+
+    if (count == 0) {
+        return false;
+    }
+    if (!out.empty()) {
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+        std::cout.flush();
+    }
+    if (!err.empty()) {
+        std::cerr.write(err.data(), static_cast<std::streamsize>(err.size()));
+        std::cerr.flush();
+    }
+    written_.store(dequeue_pos_, std::memory_order_release);
+    flushed_.notify_all();
+    return true;
+}
+
+void Logger::drain() {
+    while (running_.load(std::memory_order_relaxed)) {
+        if (!write_pending()) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait_for(lock, kIdleWait);
+        }
+    }
+    while (write_pending()) {
+    }
+}
+
+void Logger::flush() {
+    std::size_t target = enqueue_pos_.load(std::memory_order_acquire);
+    wake_.notify_one();
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (written_.load(std::memory_order_acquire) < target) {
+        flushed_.wait_for(lock, kIdleWait);
+    }
+}
+
+const char* Logger::level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO";
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    case LogLevel::Off: return "OFF";
+    }
+    return "OFF";
+}
+
+bool Logger::parse_level(std::string_view name, LogLevel& out) {
+    static const LogLevel levels[] = {LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error, LogLevel::Off};
+    for (LogLevel level : levels) {
+        std::string_view candidate = level_name(level);
+        if (candidate.size() == name.size() &&
+            std::equal(candidate.begin(), candidate.end(), name.begin(),
+                       [](char a, char b) { return a == (b >= 'a' && b <= 'z' ? b - 'a' + 'A' : b); })) {
+            out = level;
+            return true;
+        }
+    }
+    return false;
+}
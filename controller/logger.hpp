@@ -0,0 +1,122 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel : std::uint8_t { Debug, Info, Warn, Error, Off };
+
+// One structured key=value pair. Keys must be string literals (only the
+// pointer is stored); text values are copied, truncated to kTextCapacity.
+struct LogField {
+    enum class Type : std::uint8_t { Int, Uint, Double, Text };
+    static constexpr std::size_t kTextCapacity = 47;
+
+    LogField(const char* key, int value) : key(key), type(Type::Int), i(value) {}
+    LogField(const char* key, long value) : key(key), type(Type::Int), i(value) {}
+    LogField(const char* key, long long value) : key(key), type(Type::Int), i(value) {}
+    LogField(const char* key, unsigned value) : key(key), type(Type::Uint), u(value) {}
+    LogField(const char* key, unsigned long value) : key(key), type(Type::Uint), u(value) {}
+    LogField(const char* key, unsigned long long value) : key(key), type(Type::Uint), u(value) {}
+    LogField(const char* key, double value) : key(key), type(Type::Double), d(value) {}
+    LogField(const char* key, std::string_view value) : key(key), type(Type::Text), i(0), text(value) {}
+    LogField(const char* key, const char* value) : LogField(key, std::string_view(value)) {}
+
+    const char* key;
+    Type type;
+    union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+    };
+    std::string_view text;
+};
+
+using LogFields = std::initializer_list<LogField>;
+
+// Asynchronous logger. Callers format nothing and never take a lock: a
+// record is copied into a bounded lock-free MPSC ring and a background
+// thread formats and writes it ([INFO] to stdout, [ERROR] to stderr).
+// When the ring is full the record is dropped and counted rather than
+// stalling the caller.
+class Logger {
+public:
+    Logger();
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Process-wide logger shared by the servers and controller modules
+    static Logger& instance();
+
+    void debug(std::string_view msg, LogFields fields = {}) { log(LogLevel::Debug, msg, fields); }
+    void info(std::string_view msg, LogFields fields = {}) { log(LogLevel::Info, msg, fields); }
+    void warn(std::string_view msg, LogFields fields = {}) { log(LogLevel::Warn, msg, fields); }
+    void error(std::string_view msg, LogFields fields = {}) { log(LogLevel::Error, msg, fields); }
+    void log(LogLevel level, std::string_view msg, LogFields fields = {});
+
+    bool enabled(LogLevel level) const { return level >= threshold_.load(std::memory_order_relaxed); }
+    void set_level(LogLevel level) { threshold_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return threshold_.load(std::memory_order_relaxed); }
+
+    // Blocks until everything logged so far has been written
+    void flush();
+
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static const char* level_name(LogLevel level);
+    static bool parse_level(std::string_view name, LogLevel& out);
+
+private:
+    static constexpr std::size_t kCapacity = 4096;  // power of two
+    static constexpr std::size_t kMessageCapacity = 255;
+    static constexpr std::size_t kMaxFields = 6;
+
+    struct StoredField {
+        const char* key;
+        LogField::Type type;
+        std::uint8_t text_length;
+        union {
+            std::int64_t i;
+            std::uint64_t u;
+            double d;
+        };
+        char text[LogField::kTextCapacity];
+    };
+
+    struct Record {
+        std::atomic<std::size_t> sequence;
+        LogLevel level;
+        std::uint8_t field_count;
+        std::uint16_t message_length;
+        char message[kMessageCapacity];
+        std::array<StoredField, kMaxFields> fields;
+    };
+
+    void drain();
+    bool write_pending();
+
+    std::unique_ptr<Record[]> ring_;
+    alignas(64) std::atomic<std::size_t> enqueue_pos_;
+    alignas(64) std::size_t dequeue_pos_;
+    std::atomic<LogLevel> threshold_;
+    std::atomic<std::uint64_t> dropped_;
+    std::atomic<std::uint64_t> written_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable flushed_;
+    std::atomic<bool> running_;
+    std::thread worker_;
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "odometer_store.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <zlib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'F', 'P', 'O', 'D', 'O', '1', '\0'};
+
+} // namespace
+
+struct OdometerStore::Copy {
+    std::uint64_t sequence;
+    std::uint32_t checksum;  // CRC-32 of sequence and counts
+    std::uint32_t reserved;
+    std::uint64_t counts[kMaxSwitches][kPositions];
+};
+
+struct OdometerStore::File {
+    char magic[8];
+    Copy copies[2];
+};
+
+namespace {
+
+std::uint32_t checksum(std::uint64_t sequence, const std::uint64_t (&counts)[OdometerStore::kMaxSwitches][OdometerStore::kPositions]) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(&sequence), sizeof(sequence));
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(counts), sizeof(counts));
+    return static_cast<std::uint32_t>(crc);
+}
+
+} // namespace
+
+OdometerStore::OdometerStore() : dirty_(false), sequence_(0) {
+    for (auto& positions : counts_) {
+        for (auto& count : positions) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (auto& total : totals_) {
+        total.store(0, std::memory_order_relaxed);
+    }
+}
+
+OdometerStore::~OdometerStore() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (syncer_.joinable()) {
+        syncer_.join();
+    }
+    if (file_ != nullptr && dirty_.exchange(false)) {
+        sync_or_retry();
+    }
+    close_file();
+}
+
+std::uint64_t OdometerStore::record(int slot, int position) {
+    if (slot < 0 || slot >= kMaxSwitches || position < 0 || position >= kPositions) {
+        return 0;
+    }
+    counts_[slot][position].fetch_add(1, std::memory_order_relaxed);
+    if (!dirty_.load(std::memory_order_relaxed)) {
+        dirty_.store(true, std::memory_order_relaxed);
+    }
+    return totals_[slot].fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+std::uint64_t OdometerStore::total(int slot) const {
+    return slot >= 0 && slot < kMaxSwitches ? totals_[slot].load(std::memory_order_relaxed) : 0;
+}
+
+std::uint64_t OdometerStore::count(int slot, int position) const {
+    if (slot < 0 || slot >= kMaxSwitches || position < 0 || position >= kPositions) {
+        return 0;
+    }
+    return counts_[slot][position].load(std::memory_order_relaxed);
+}
+
+void OdometerStore::syncer() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    while (!stopping_) {
+        wake_.wait_for(lock, sync_interval_, [this] { return stopping_; });
+        if (stopping_) {
+            break;
+        }
+        if (dirty_.exchange(false)) {
+            lock.unlock();
+            sync_or_retry();
+            lock.lock();
+        }
+    }
+}
+
+void OdometerStore::sync_or_retry() {
+    if (!sync()) {
+        int error = errno;
+        // Still dirty, so the next interval retries even if no switch moves
+        dirty_.store(true);
+        Logger::instance().error("Failed to persist odometers", {{"file", path_}, {"error", std::strerror(error)}});
+    }
+}
+
+#ifdef _WIN32
+
+bool OdometerStore::open(const std::string&, std::chrono::milliseconds, std::string& error) {
+    error = "persistent odometers are not available on Windows";
+    return false;
+}
+
+bool OdometerStore::sync() {
+    return false;
+}
+
+void OdometerStore::close_file() {}
+
+#else
+
+bool OdometerStore::open(const std::string& path, std::chrono::milliseconds sync_interval, std::string& error) {
+    if (file_ != nullptr) {
+        error = "odometer file already open";
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    bool fresh = info.st_size == 0;
+    if (!fresh && static_cast<std::size_t>(info.st_size) != sizeof(File)) {
+        error = path + ": not an odometer file";
+        ::close(fd);
+        return false;
+    }
+    if (fresh && ftruncate(fd, sizeof(File)) < 0) {
+        error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        error = path + ": mmap failed: " + std::strerror(errno);
+        return false;
+    }
+    File* file = static_cast<File*>(mapping);
+
+    if (fresh) {
+        std::memset(file, 0, sizeof(File));
+        std::memcpy(file->magic, kMagic, sizeof(kMagic));
+    } else if (std::memcmp(file->magic, kMagic, sizeof(kMagic)) != 0) {
+        error = path + ": not an odometer file";
+        munmap(mapping, sizeof(File));
+        return false;
+    }
+
+    // Newest copy whose checksum holds; a torn write only ever hits one of them
+    int newest = -1;
+    for (int i = 0; i < 2; ++i) {
+        const Copy& copy = file->copies[i];
+        if (copy.sequence != 0 && copy.checksum == checksum(copy.sequence, copy.counts) &&
+            (newest < 0 || copy.sequence > file->copies[newest].sequence)) {
+            newest = i;
+        }
+    }
+    if (newest >= 0) {
+        const Copy& copy = file->copies[newest];
+        for (int slot = 0; slot < kMaxSwitches; ++slot) {
+            std::uint64_t total = 0;
+            for (int position = 0; position < kPositions; ++position) {
+                // Counts recorded before open() are kept on top of the persisted ones
+                std::uint64_t count = counts_[slot][position].load(std::memory_order_relaxed) + copy.counts[slot][position];
+                counts_[slot][position].store(count, std::memory_order_relaxed);
+                total += count;
+            }
+            totals_[slot].store(total, std::memory_order_relaxed);
+        }
+        sequence_.store(copy.sequence, std::memory_order_relaxed);
+        next_copy_ = 1 - newest;
+    } else {
+        next_copy_ = 0;
+    }
+
+    path_ = path;
+    file_ = file;
+    sync_interval_ = sync_interval.count() > 0 ? sync_interval : std::chrono::milliseconds(1000);
+    syncer_ = std::thread(&OdometerStore::syncer, this);
+    return true;
+}
+
+bool OdometerStore::sync() {
+    std::lock_guard<std::mutex> lock(sync_mutex_);
+    if (file_ == nullptr) {
+        return false;
+    }
+    Copy& copy = file_->copies[next_copy_];
+    std::uint64_t sequence = sequence_.load(std::memory_order_relaxed) + 1;
+    for (int slot = 0; slot < kMaxSwitches; ++slot) {
+        for (int position = 0; position < kPositions; ++position) {
+            copy.counts[slot][position] = counts_[slot][position].load(std::memory_order_relaxed);
+        }
+    }
+    copy.sequence = sequence;
+    copy.checksum = checksum(sequence, copy.counts);
+    if (msync(file_, sizeof(File), MS_SYNC) < 0) {
+        return false;
+    }
+    sequence_.store(sequence, std::memory_order_relaxed);
+    next_copy_ = 1 - next_copy_;
+    return true;
+}
+
+void OdometerStore::close_file() {
+    if (file_ != nullptr) {
+        munmap(file_, sizeof(File));
+        file_ = nullptr;
+    }
+}
+
+#endif
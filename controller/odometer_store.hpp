@@ -0,0 +1,75 @@
+#ifndef ODOMETER_STORE_HPP
+#define ODOMETER_STORE_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Actuation counters per switch (SW1 .. SW8) and per position (gpio value),
+// for tracking relay cycle life. Counting is two relaxed atomic increments;
+// a background thread persists the counters every sync interval while they
+// are dirty.
+//
+// The file holds two checksummed copies of the counters. A sync writes the
+// older copy and msyncs it, so a crash mid-write leaves the other copy
+// intact; loading picks the valid copy with the higher sequence. Without
+// open() (or on Windows) the counters live in memory only.
+class OdometerStore {
+public:
+    static constexpr int kMaxSwitches = 8;
+    static constexpr int kPositions = 256;
+
+    OdometerStore();
+    ~OdometerStore();  // final sync
+
+    OdometerStore(const OdometerStore&) = delete;
+    OdometerStore& operator=(const OdometerStore&) = delete;
+
+    // Maps path (created if missing), loads the newest valid copy and syncs
+    // every sync_interval from then on
+    bool open(const std::string& path, std::chrono::milliseconds sync_interval, std::string& error);
+
+    // A switch moved into position; returns its new total. Out of range slots are ignored.
+    std::uint64_t record(int slot, int position);
+
+    std::uint64_t total(int slot) const;
+    std::uint64_t count(int slot, int position) const;
+
+    // Writes the spare copy now; false if not open or msync failed
+    bool sync();
+
+    std::uint64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }  // of the last persisted copy
+    const std::string& path() const { return path_; }
+
+private:
+    struct Copy;
+    struct File;
+
+    void syncer();
+    void sync_or_retry();  // sync(); on failure logs and marks the counters dirty again
+    void close_file();
+
+    std::chrono::milliseconds sync_interval_{1000};
+    std::array<std::array<std::atomic<std::uint64_t>, kPositions>, kMaxSwitches> counts_;
+    std::array<std::atomic<std::uint64_t>, kMaxSwitches> totals_;
+    std::atomic<bool> dirty_;
+    std::atomic<std::uint64_t> sequence_;
+
+    std::string path_;
+    File* file_ = nullptr;
+    int next_copy_ = 0;
+
+    std::mutex sync_mutex_;  // one sync at a time
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread syncer_;
+};
+
+#endif
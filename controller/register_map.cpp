@@ -0,0 +1,244 @@
+#include "register_map.hpp"
+#include "sim_chassis.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Orders a register store against everything after it. Device memory is
+// mapped uncached, but the CPU may still buffer the store; on ARM only a
+// DSB guarantees it has reached the interconnect.
+inline void io_barrier() {
+#if defined(__aarch64__)
+    __asm__ __volatile__("dsb sy" ::: "memory");
+#elif defined(__arm__)
+    __asm__ __volatile__("dsb" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("mfence" ::: "memory");
+#elif defined(__GNUC__)
+    __sync_synchronize();
+#endif
+}
+
+#ifndef _WIN32
+
+std::size_t page_size() {
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<std::size_t>(size) : 4096;
+}
+
+// "0x43c00000\n" from sysfs; false if the file is missing or unreadable
+bool read_sysfs_hex(const std::string& path, unsigned long long& value) {
+    std::ifstream file(path);
+    std::string text;
+    if (!(file >> text)) {
+        return false;
+    }
+    char* end = nullptr;
+    value = std::strtoull(text.c_str(), &end, 0);
+    return end != text.c_str();
+}
+
+#endif
+
+} // namespace
+
+RegisterMap::RegisterMap(Kind kind, std::string source, std::uint32_t base, std::size_t size)
+    : kind_(kind), source_(std::move(source)), base_(base), size_(size) {}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_chassis(const std::string& name, std::string& error) {
+    std::unique_ptr<SimChassis> chassis = SimChassis::attach(name, error);
+    if (!chassis) {
+        return nullptr;
+    }
+    std::unique_ptr<RegisterMap> map(new RegisterMap(Kind::Chassis, name, chassis->base(), chassis->size()));
+    map->chassis_ = std::move(chassis);
+    return map;
+}
+
+#ifdef _WIN32
+
+RegisterMap::~RegisterMap() = default;
+
+std::unique_ptr<RegisterMap> RegisterMap::open_uio(const std::string&, std::uint32_t, std::size_t, std::string& error) {
+    error = "UIO register access is not available on Windows";
+    return nullptr;
+}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_devmem(std::uint32_t, std::size_t, std::string& error) {
+    error = "/dev/mem register access is not available on Windows";
+    return nullptr;
+}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_simulated(const std::string& path, std::uint32_t base,
+                                                         std::size_t size, std::string& error) {
+    if (!path.empty()) {
+        error = "file backed simulated registers are not available on Windows";
+        return nullptr;
+    }
+    std::unique_ptr<RegisterMap> map(new RegisterMap(Kind::Simulated, "", base, size));
+    map->memory_.reset(new std::uint8_t[size]());
+    map->window_ = map->memory_.get();
+    return map;
+}
+
+#else
+
+RegisterMap::~RegisterMap() {
+    if (mapping_ != nullptr) {
+        munmap(mapping_, mapping_size_);
+    }
+}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_uio(const std::string& device, std::uint32_t base, std::size_t size,
+                                                   std::string& error) {
+    // The kernel knows where map0 is; prefer that over the configured window
+    std::string name = device.substr(device.rfind('/') + 1);
+    unsigned long long sysfs_addr;
+    unsigned long long sysfs_size;
+    if (read_sysfs_hex("/sys/class/uio/" + name + "/maps/map0/addr", sysfs_addr) &&
+        read_sysfs_hex("/sys/class/uio/" + name + "/maps/map0/size", sysfs_size)) {
+        base = static_cast<std::uint32_t>(sysfs_addr);
+        size = static_cast<std::size_t>(sysfs_size);
+    }
+
+    int fd = ::open(device.c_str(), O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd < 0) {
+        error = device + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    // UIO selects map N with offset N * page size; map0 starts at base
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = device + ": mmap failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    std::unique_ptr<RegisterMap> map(new RegisterMap(Kind::Uio, device, base, size));
+    map->mapping_ = mapping;
+    map->mapping_size_ = size;
+    map->window_ = static_cast<volatile std::uint8_t*>(mapping);
+    return map;
+}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_devmem(std::uint32_t base, std::size_t size, std::string& error) {
+    int fd = ::open("/dev/mem", O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd < 0) {
+        error = std::string("/dev/mem: ") + std::strerror(errno);
+        return nullptr;
+    }
+    // mmap offsets must be page aligned; the window starts inside the first page
+    std::size_t lead = base % page_size();
+    void* mapping = mmap(nullptr, size + lead, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                         static_cast<off_t>(base - lead));
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = std::string("/dev/mem: mmap failed: ") + std::strerror(errno);
+        return nullptr;
+    }
+    std::unique_ptr<RegisterMap> map(new RegisterMap(Kind::DevMem, "/dev/mem", base, size));
+    map->mapping_ = mapping;
+    map->mapping_size_ = size + lead;
+    map->window_ = static_cast<volatile std::uint8_t*>(mapping) + lead;
+    return map;
+}
+
+std::unique_ptr<RegisterMap> RegisterMap::open_simulated(const std::string& path, std::uint32_t base,
+                                                         std::size_t size, std::string& error) {
+    void* mapping;
+    if (path.empty()) {
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    } else {
+        // Registers power up as zero: start from an empty file every time
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+            error = path + ": " + std::strerror(errno);
+            close(fd);
+            return nullptr;
+        }
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    if (mapping == MAP_FAILED) {
+        error = (path.empty() ? std::string("anonymous") : path) + ": mmap failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    std::unique_ptr<RegisterMap> map(new RegisterMap(Kind::Simulated, path, base, size));
+    map->mapping_ = mapping;
+    map->mapping_size_ = size;
+    map->window_ = static_cast<volatile std::uint8_t*>(mapping);
+    return map;
+}
+
+#endif
+
+std::unique_ptr<RegisterMap> RegisterMap::open(const std::string& spec, std::uint32_t base, std::size_t size,
+                                               std::string& error) {
+    if (size == 0) {
+        error = "register window size is 0";
+        return nullptr;
+    }
+    if (spec.rfind("uio:", 0) == 0) {
+        return open_uio(spec.substr(4), base, size, error);
+    }
+    if (spec == "devmem") {
+        return open_devmem(base, size, error);
+    }
+    if (spec == "sim") {
+        return open_simulated("", base, size, error);
+    }
+    if (spec.rfind("sim:", 0) == 0) {
+        return open_simulated(spec.substr(4), base, size, error);
+    }
+    if (spec.rfind("chassis:", 0) == 0) {
+        return open_chassis(spec.substr(8), error);
+    }
+    error = "unknown register backend '" + spec + "', use uio:<device>, devmem, sim, sim:<file> or chassis:<name>";
+    return nullptr;
+}
+
+bool RegisterMap::write8(std::uint32_t addr, std::uint8_t value) {
+    if (chassis_) {
+        return chassis_->write(addr, value);
+    }
+    if (!contains(addr)) {
+        return false;
+    }
+    window_[addr - base_] = value;
+    io_barrier();
+    return true;
+}
+
+bool RegisterMap::read8(std::uint32_t addr, std::uint8_t& value) const {
+    if (chassis_) {
+        return chassis_->read(addr, value);
+    }
+    if (!contains(addr)) {
+        return false;
+    }
+    value = window_[addr - base_];
+    return true;
+}
+
+const char* RegisterMap::kind_name() const {
+    switch (kind_) {
+    case Kind::Uio: return "uio";
+    case Kind::DevMem: return "devmem";
+    case Kind::Simulated: return "simulated";
+    case Kind::Chassis: return "chassis";
+    }
+    return "unknown";
+}
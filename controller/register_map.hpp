@@ -0,0 +1,73 @@
+#ifndef REGISTER_MAP_HPP
+#define REGISTER_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class SimChassis;
+
+// The AXI GPIO register window the switches are wired to, memory mapped.
+// Every backend hands out the same thing, a window of bytes covering
+// [base, base + size), so a register write is one volatile store plus a
+// barrier whether it lands on the FPGA or in simulated memory:
+//
+//   uio       /dev/uioN, map0 (base and size come from sysfs when present)
+//   devmem    /dev/mem at the physical base address, needs root
+//   simulated shared memory, file backed (e.g. /dev/shm/sfp_registers) so a
+//             test or another process can map the same file and inspect the
+//             registers, or anonymous when no file is given
+//   chassis   the shared-memory chassis model of sim_chassis.hpp, which also
+//             counts actuations and relay timing
+//
+// Windows builds only have the simulated backend, in process memory.
+class RegisterMap {
+public:
+    enum class Kind { Uio, DevMem, Simulated, Chassis };
+
+    static std::unique_ptr<RegisterMap> open_uio(const std::string& device, std::uint32_t base, std::size_t size,
+                                                 std::string& error);
+    static std::unique_ptr<RegisterMap> open_devmem(std::uint32_t base, std::size_t size, std::string& error);
+    static std::unique_ptr<RegisterMap> open_simulated(const std::string& path, std::uint32_t base,
+                                                       std::size_t size, std::string& error);
+    // Window, base and size are the chassis segment's own
+    static std::unique_ptr<RegisterMap> open_chassis(const std::string& name, std::string& error);
+
+    // "uio:/dev/uio0", "devmem", "sim", "sim:<file>" or "chassis:<shm name>";
+    // nullptr and error on failure
+    static std::unique_ptr<RegisterMap> open(const std::string& spec, std::uint32_t base, std::size_t size,
+                                             std::string& error);
+
+    ~RegisterMap();
+
+    RegisterMap(const RegisterMap&) = delete;
+    RegisterMap& operator=(const RegisterMap&) = delete;
+
+    // False if addr is outside the window
+    bool write8(std::uint32_t addr, std::uint8_t value);
+    bool read8(std::uint32_t addr, std::uint8_t& value) const;
+
+    Kind kind() const { return kind_; }
+    const char* kind_name() const;
+    const std::string& source() const { return source_; }  // device or file, empty if anonymous
+    std::uint32_t base() const { return base_; }
+    std::size_t size() const { return size_; }
+
+private:
+    RegisterMap(Kind kind, std::string source, std::uint32_t base, std::size_t size);
+
+    bool contains(std::uint32_t addr) const { return addr >= base_ && addr - base_ < size_; }
+
+    Kind kind_;
+    std::string source_;
+    std::uint32_t base_;
+    std::size_t size_;
+    volatile std::uint8_t* window_ = nullptr;  // byte for address base_
+    void* mapping_ = nullptr;                  // what munmap gets back, page aligned
+    std::size_t mapping_size_ = 0;
+    std::unique_ptr<std::uint8_t[]> memory_;   // simulated backend without mmap
+    std::unique_ptr<SimChassis> chassis_;      // chassis backend, instead of window_
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "ring_task_queue.hpp"
+#include <utility>
+
+namespace {
+
+std::size_t round_up_pow2(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+RingTaskQueue::Ring::Ring(std::size_t capacity)
+    : mask_(capacity - 1), slots_(new Slot[capacity]), enqueue_pos_(0), dequeue_pos_(0) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+        slots_[i].task = nullptr;
+    }
+}
+
+bool RingTaskQueue::Ring::push(Task* task) {
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots_[pos & mask_];
+        std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.task = task;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;  // full
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+RingTaskQueue::Task* RingTaskQueue::Ring::pop() {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots_[pos & mask_];
+        std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                Task* task = slot.task;
+                slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                return task;
+            }
+        } else if (diff < 0) {
+            return nullptr;  // empty
+        } else {
+            pos = dequeue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+RingTaskQueue::RingTaskQueue(std::size_t workers, std::size_t max_queued)
+    : max_queued_(max_queued),
+      ring_(round_up_pow2(max_queued > 0 ? max_queued : kUnboundedCapacity)),
+      queued_(0),
+      sleepers_(0),
+      stopping_(false) {
+    if (workers == 0) {
+        workers = 1;
+    }
+    for (std::size_t i = 0; i < workers; ++i) {
+        threads_.emplace_back(&RingTaskQueue::run, this);
+    }
+}
+
+RingTaskQueue::~RingTaskQueue() {
+    if (!threads_.empty()) {
+        shutdown();
+    }
+}
+
+bool RingTaskQueue::enqueue(std::function<void()> fn) {
+    // Claim a place first, so the limit holds with many producers
+    std::size_t queued = queued_.fetch_add(1, std::memory_order_seq_cst);
+    if (max_queued_ > 0 && queued >= max_queued_) {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    Task* task = new Task(std::move(fn));
+    if (!ring_.push(task)) {
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        delete task;
+        return false;
+    }
+    // Pairs with park(): either its second look finds the task or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void RingTaskQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_.store(true);
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+RingTaskQueue::Task* RingTaskQueue::park() {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Second look now that enqueue() can see us: a task published before its
+    // sleepers_ check turns up here, a later one comes with a notify
+    Task* task = ring_.pop();
+    if (task == nullptr && !stopping_.load()) {
+        wake_.wait(lock);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+void RingTaskQueue::run() {
+    for (;;) {
+        Task* task = ring_.pop();
+        if (task == nullptr) {
+            task = park();
+        }
+        if (task == nullptr) {
+            // Queued work may still be in flight between enqueue and the ring
+            if (stopping_.load() && queued_.load() == 0) {
+                break;
+            }
+            continue;
+        }
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        (*task)();
+        delete task;
+    }
+}
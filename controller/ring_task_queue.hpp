@@ -0,0 +1,77 @@
+#ifndef RING_TASK_QUEUE_HPP
+#define RING_TASK_QUEUE_HPP
+
+#include <httplib.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Task queue for httplib::Server (Server::new_task_queue): a bounded MPMC
+// ring (Vyukov) instead of httplib::ThreadPool's mutex-guarded list. httplib
+// enqueues only from its accept thread and every worker takes from the one
+// ring, so there is no per-worker queue and nothing to steal. Enqueue and
+// take are lock-free; workers with nothing to do sleep on a condition
+// variable, which the enqueue path only touches when someone is asleep.
+// It does not beat ThreadPool on throughput (bench/task_queue_bench.cpp);
+// what it changes is that the accept thread never waits on a worker
+// holding the queue's mutex.
+//
+// Like ThreadPool, max_queued > 0 refuses tasks once that many are waiting
+// (httplib then closes the connection), and shutdown() runs what is queued
+// before joining. With max_queued = 0 the limit is the ring,
+// kUnboundedCapacity tasks.
+class RingTaskQueue final : public httplib::TaskQueue {
+public:
+    static constexpr std::size_t kUnboundedCapacity = 65536;
+
+    explicit RingTaskQueue(std::size_t workers, std::size_t max_queued = 0);
+    ~RingTaskQueue() override;
+
+    RingTaskQueue(const RingTaskQueue&) = delete;
+    RingTaskQueue& operator=(const RingTaskQueue&) = delete;
+
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+private:
+    using Task = std::function<void()>;
+
+    // Vyukov bounded MPMC ring
+    class Ring {
+    public:
+        explicit Ring(std::size_t capacity);
+        bool push(Task* task);  // false when full
+        Task* pop();            // nullptr when empty
+
+    private:
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            Task* task;
+        };
+        std::size_t mask_;
+        std::unique_ptr<Slot[]> slots_;
+        alignas(64) std::atomic<std::size_t> enqueue_pos_;
+        alignas(64) std::atomic<std::size_t> dequeue_pos_;
+    };
+
+    void run();
+    Task* park();  // sleeps until notified, unless a last look finds a task
+
+    const std::size_t max_queued_;
+    Ring ring_;
+    alignas(64) std::atomic<std::size_t> queued_;  // enqueued and not yet taken by a worker
+    alignas(64) std::atomic<std::size_t> sleepers_;
+    std::atomic<bool> stopping_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::vector<std::thread> threads_;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include "route_table.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// paths.json names switches "switch1", "switch2"; SCPI and components_paths.json use "SW1", "SW2"
+std::string switch_id_for(const std::string& path_component_id) {
+    if (path_component_id.rfind("switch", 0) == 0) {
+        return "SW" + path_component_id.substr(6);
+    }
+    return path_component_id;
+}
+
+bool read_json_file(const std::string& filename, nlohmann::json& out, std::string& error) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        error = "Failed to open " + filename;
+        return false;
+    }
+    try {
+        file >> out;
+    } catch (const nlohmann::json::exception& e) {
+        error = "Failed to parse " + filename + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+T unsigned_field(const nlohmann::json& object, const char* key, uint64_t max) {
+    const nlohmann::json& value = object.at(key);
+    if (!value.is_number_unsigned() || value.get<uint64_t>() > max) {
+        throw std::runtime_error(std::string("'") + key + "' must be an integer between 0 and " +
+                                 std::to_string(max) + " in " + object.dump());
+    }
+    return static_cast<T>(value.get<uint64_t>());
+}
+
+} // namespace
+
+int RouteTable::add_component(const std::string& id) {
+    auto it = component_index_.find(id);
+    if (it != component_index_.end()) {
+        return it->second;
+    }
+    if (components_.size() >= kMaxComponents) {
+        throw std::runtime_error("more than " + std::to_string(kMaxComponents) + " components");
+    }
+    Component component;
+    component.id = id;
+    component.address = 0;
+    components_.push_back(std::move(component));
+    int index = static_cast<int>(components_.size() - 1);
+    component_index_.emplace(id, index);
+    return index;
+}
+
+std::shared_ptr<const RouteTable> RouteTable::build(const nlohmann::json& paths_config,
+                                                    const nlohmann::json& components_config) {
+    std::shared_ptr<RouteTable> table(new RouteTable());
+
+    if (components_config.is_object() && components_config.contains("components") &&
+        components_config["components"].is_array()) {
+        table->components_loaded_ = true;
+        table->components_json_ = components_config["components"];
+        for (const auto& info : table->components_json_) {
+            if (!info.contains("id") || !info["id"].is_string()) {
+                throw std::runtime_error("component without a string 'id'");
+            }
+            int index = table->add_component(info["id"].get<std::string>());
+            Component& component = table->components_[index];
+            component.info = info;
+            component.info_json = info.dump();
+            if (info.contains("address")) {
+                component.address = unsigned_field<uint32_t>(info, "address", UINT32_MAX);
+            }
+        }
+    }
+
+    // Writes tagged with their path id until they are grouped below
+    std::vector<std::pair<int, PathEntry>> writes;
+    std::array<bool, kMaxPathId + 1> defined{};
+
+    if (paths_config.is_object() && paths_config.contains("paths") &&
+        paths_config["paths"].is_array()) {
+        table->paths_loaded_ = true;
+        table->paths_json_ = paths_config["paths"];
+        for (const auto& path : table->paths_json_) {
+            int path_id = unsigned_field<int>(path, "id", kMaxPathId);
+            if (!path.at("component_id").is_string()) {
+                throw std::runtime_error("'component_id' must be a string in " + path.dump());
+            }
+            std::string path_component_id = path["component_id"].get<std::string>();
+            int index = table->add_component(switch_id_for(path_component_id));
+            table->components_[index].path_component_id = path_component_id;
+
+            PathEntry entry;
+            entry.address = unsigned_field<uint32_t>(path, "address", UINT32_MAX);
+            entry.gpio_value = unsigned_field<uint8_t>(path, "gpio_value", UINT8_MAX);
+            entry.component = static_cast<uint8_t>(index);
+            writes.emplace_back(path_id, entry);
+            defined[path_id] = true;
+        }
+    }
+
+    // components_paths.json paths name a component instead of an address;
+    // paths.json wins for any id it defines
+    if (components_config.is_object() && components_config.contains("paths") &&
+        components_config["paths"].is_array()) {
+        for (const auto& path : components_config["paths"]) {
+            int path_id = unsigned_field<int>(path, "id", kMaxPathId);
+            if (defined[path_id]) {
+                continue;
+            }
+            if (!path.at("componentId").is_string()) {
+                throw std::runtime_error("'componentId' must be a string in " + path.dump());
+            }
+            int index = table->find_component(path["componentId"].get<std::string>());
+            if (index < 0 || !table->components_[index].info.contains("address")) {
+                throw std::runtime_error("'componentId' does not name a component with an address in " +
+                                         path.dump());
+            }
+            Component& component = table->components_[index];
+            if (component.path_component_id.empty()) {
+                component.path_component_id = component.id;
+            }
+
+            PathEntry entry;
+            entry.address = component.address;
+            entry.gpio_value = unsigned_field<uint8_t>(path, "gpioValue", UINT8_MAX);
+            entry.component = static_cast<uint8_t>(index);
+            writes.emplace_back(path_id, entry);
+        }
+    }
+
+    // Group writes by path id, keeping file order inside a path
+    std::stable_sort(writes.begin(), writes.end(),
+                     [](const std::pair<int, PathEntry>& a, const std::pair<int, PathEntry>& b) {
+                         return a.first < b.first;
+                     });
+
+    const std::size_t count = table->components_.size();
+    table->entries_.reserve(writes.size());
+    table->entry_index_.assign((kMaxPathId + 1) * count, -1);
+    std::size_t next = 0;
+    for (int id = 0; id <= kMaxPathId + 1; ++id) {
+        table->path_offsets_[id] = static_cast<std::uint32_t>(next);
+        for (; next < writes.size() && writes[next].first == id; ++next) {
+            const PathEntry& entry = writes[next].second;
+            std::int32_t& slot = table->entry_index_[id * count + entry.component];
+            if (slot == -1) {
+                slot = static_cast<std::int32_t>(next); // first match wins, as the old linear scan did
+            }
+            table->entries_.push_back(entry);
+        }
+    }
+
+    return table;
+}
+
+std::shared_ptr<const RouteTable> RouteTable::load(const std::string& paths_file,
+                                                   const std::string& components_file) {
+    nlohmann::json paths_config;
+    nlohmann::json components_config;
+    std::string error;
+    if (!read_json_file(paths_file, paths_config, error)) {
+        Logger::instance().error(error);
+    }
+    if (!read_json_file(components_file, components_config, error)) {
+        Logger::instance().error(error);
+    }
+    try {
+        return build(paths_config, components_config);
+    } catch (const std::exception& e) {
+        Logger::instance().error(std::string("Invalid route configuration: ") + e.what());
+        return build(nlohmann::json(), nlohmann::json());
+    }
+}
+
+std::shared_ptr<const RouteTable> RouteTable::try_load(const std::string& paths_file,
+                                                       const std::string& components_file,
+                                                       std::string& error) {
+    nlohmann::json paths_config;
+    nlohmann::json components_config;
+    if (!read_json_file(paths_file, paths_config, error) ||
+        !read_json_file(components_file, components_config, error)) {
+        return nullptr;
+    }
+    try {
+        std::shared_ptr<const RouteTable> table = build(paths_config, components_config);
+        if (!table->paths_loaded()) {
+            error = paths_file + " has no 'paths' array";
+            return nullptr;
+        }
+        if (!table->components_loaded()) {
+            error = components_file + " has no 'components' array";
+            return nullptr;
+        }
+        return table;
+    } catch (const std::exception& e) {
+        error = std::string("Invalid route configuration: ") + e.what();
+        return nullptr;
+    }
+}
+
+const PathEntry* RouteTable::path_begin(int path_id) const {
+    if (path_id < 0 || path_id > kMaxPathId) {
+        return nullptr;
+    }
+    return entries_.data() + path_offsets_[path_id];
+}
+
+const PathEntry* RouteTable::path_end(int path_id) const {
+    if (path_id < 0 || path_id > kMaxPathId) {
+        return nullptr;
+    }
+    return entries_.data() + path_offsets_[path_id + 1];
+}
+
+bool RouteTable::has_path(int path_id) const {
+    return path_begin(path_id) != path_end(path_id);
+}
+
+const PathEntry* RouteTable::find_entry(int path_id, int component) const {
+    if (path_id < 0 || path_id > kMaxPathId || component < 0 ||
+        component >= static_cast<int>(components_.size())) {
+        return nullptr;
+    }
+    std::int32_t index = entry_index_[path_id * components_.size() + component];
+    return index < 0 ? nullptr : &entries_[index];
+}
+
+int RouteTable::find_component(const std::string& switch_id) const {
+    auto it = component_index_.find(switch_id);
+    return it == component_index_.end() ? -1 : it->second;
+}
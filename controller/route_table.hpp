@@ -0,0 +1,92 @@
+#ifndef ROUTE_TABLE_HPP
+#define ROUTE_TABLE_HPP
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One register write belonging to a path. Packed to 8 bytes: a path's
+// writes sit next to each other, so PATH:SELECT walks one or two cache lines
+struct PathEntry {
+    uint32_t address;
+    uint8_t gpio_value;
+    uint8_t component;  // index into RouteTable components
+};
+static_assert(sizeof(PathEntry) == 8, "PathEntry is packed into the write list");
+
+// A switch known to the chassis, keyed by its SCPI id ("SW1", "SW2", ...)
+struct Component {
+    std::string id;
+    std::string path_component_id; // id used by paths.json ("switch1", ...)
+    uint32_t address;
+    nlohmann::json info;            // components_paths.json object, null if not described there
+    std::string info_json;          // info, compact, for replies written with JsonWriter
+};
+
+// Immutable, indexed view of paths.json and components_paths.json.
+// Built once from the files so the request path never touches the disk
+// or walks a JSON DOM. Every path id compiles to a contiguous run of
+// PathEntry writes. A path id paths.json does not define is compiled from
+// the "paths" of components_paths.json instead, joining componentId to
+// the component's address here rather than per command.
+class RouteTable {
+public:
+    static constexpr int kMaxPathId = 255;
+    static constexpr std::size_t kMaxComponents = 256;  // PathEntry::component is 8 bits
+
+    // Throws std::runtime_error / nlohmann::json::exception on malformed entries
+    static std::shared_ptr<const RouteTable> build(const nlohmann::json& paths_config,
+                                                   const nlohmann::json& components_config);
+
+    // Startup load: unreadable or invalid files leave the matching section empty
+    static std::shared_ptr<const RouteTable> load(const std::string& paths_file,
+                                                  const std::string& components_file);
+
+    // Reload: both files must read, parse and validate, otherwise nullptr and error is set
+    static std::shared_ptr<const RouteTable> try_load(const std::string& paths_file,
+                                                      const std::string& components_file,
+                                                      std::string& error);
+
+    // Entries of a path in file order; empty range for unknown ids
+    const PathEntry* path_begin(int path_id) const;
+    const PathEntry* path_end(int path_id) const;
+    bool has_path(int path_id) const;
+
+    // Entry of one component inside a path, nullptr if the path does not use it
+    const PathEntry* find_entry(int path_id, int component) const;
+
+    // Component index for "SW1"/"SW2", -1 if unknown
+    int find_component(const std::string& switch_id) const;
+    const Component& component(int index) const { return components_[index]; }
+    std::size_t component_count() const { return components_.size(); }
+    std::size_t entry_count() const { return entries_.size(); }
+
+    // Raw sections, kept for GET /config
+    const nlohmann::json& paths_json() const { return paths_json_; }
+    const nlohmann::json& components_json() const { return components_json_; }
+    bool paths_loaded() const { return paths_loaded_; }
+    bool components_loaded() const { return components_loaded_; }
+
+private:
+    RouteTable() = default;
+
+    int add_component(const std::string& id);
+
+    std::vector<PathEntry> entries_;                          // grouped by path id
+    std::array<std::uint32_t, kMaxPathId + 2> path_offsets_{}; // path id -> first entry
+    std::vector<std::int32_t> entry_index_;                   // path id * components + component -> entry, -1 if none
+    std::vector<Component> components_;
+    std::unordered_map<std::string, int> component_index_;
+
+    nlohmann::json paths_json_ = nlohmann::json::array();
+    nlohmann::json components_json_ = nlohmann::json::array();
+    bool paths_loaded_ = false;
+    bool components_loaded_ = false;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef SCPI_PARSER_HPP
+#define SCPI_PARSER_HPP
+
+// Header-only SCPI command registry shared by sfp_server, interface_sim and
+// the Mario backend. Command headers are compiled into a keyword trie at
+// compile time; parsing is allocation free and case-insensitive, and accepts
+// both the short and the long form of every keyword (ROUT:PATH, ROUTE:PATH).
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace scpi {
+
+enum class Command : std::uint8_t {
+    Unknown,
+    PathSelect,    // PATH:SELect <path_id>
+    SwitchSelect,  // SWITch:SELect <switch_id> <gpio_value>
+    SwitchInfo,    // SWITch:INFO? <switch_number>
+    RoutePath,     // ROUTe:PATH[?] <path_id>
+    OperationComplete,  // *OPC?
+    State,         // STATe?
+};
+
+struct CommandPattern {
+    std::string_view header;
+    Command command;
+};
+
+// SCPI notation: the upper-case prefix of a keyword is its short form, the
+// whole keyword its long form. A trailing '?' registers the query form.
+inline constexpr CommandPattern kCommandPatterns[] = {
+    {"PATH:SELect", Command::PathSelect},
+    {"SWITch:SELect", Command::SwitchSelect},
+    {"SWITch:INFO?", Command::SwitchInfo},
+    {"ROUTe:PATH", Command::RoutePath},
+    {"ROUTe:PATH?", Command::RoutePath},
+    {"*OPC?", Command::OperationComplete},
+    {"STATe?", Command::State},
+};
+
+struct ParsedCommand {
+    Command command = Command::Unknown;
+    bool query = false;
+    std::string_view header;
+    std::string_view args;  // everything after the header, trimmed
+};
+
+namespace detail {
+
+constexpr std::size_t kMaxKeywordLength = 15;
+
+struct TrieNode {
+    std::string_view keyword;  // as written in the pattern, mixed case
+    char upper[kMaxKeywordLength] = {};
+    std::uint8_t long_length = 0;
+    std::uint8_t short_length = 0;
+    std::int8_t first_child = -1;
+    std::int8_t next_sibling = -1;
+    Command command = Command::Unknown;
+    Command query = Command::Unknown;
+};
+
+constexpr std::size_t kMaxTrieNodes = 32;
+
+struct Trie {
+    std::array<TrieNode, kMaxTrieNodes> nodes{};
+    std::size_t size = 1;  // node 0 is the root
+};
+
+constexpr bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+constexpr char to_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+constexpr std::uint8_t short_length(std::string_view keyword) {
+    std::uint8_t n = 0;
+    while (n < keyword.size() && !(keyword[n] >= 'a' && keyword[n] <= 'z')) {
+        ++n;
+    }
+    return n;
+}
+
+// Input keyword is either the short or the long form, in any case
+constexpr bool keyword_matches(const TrieNode& node, std::string_view input) {
+    if (input.size() != node.long_length && input.size() != node.short_length) {
+        return false;
+    }
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        if (to_upper(input[i]) != node.upper[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr Trie build_trie() {
+    Trie trie;
+    for (const CommandPattern& pattern : kCommandPatterns) {
+        std::string_view header = pattern.header;
+        bool query = !header.empty() && header.back() == '?';
+        if (query) {
+            header.remove_suffix(1);
+        }
+        std::size_t node = 0;
+        while (!header.empty()) {
+            std::size_t colon = header.find(':');
+            std::string_view keyword = header.substr(0, colon);
+            header = colon == std::string_view::npos ? std::string_view() : header.substr(colon + 1);
+
+            int child = trie.nodes[node].first_child;
+            while (child >= 0 && trie.nodes[child].keyword != keyword) {
+                child = trie.nodes[child].next_sibling;
+            }
+            if (child < 0) {
+                if (trie.size == kMaxTrieNodes) {
+                    throw "SCPI command trie is full, raise kMaxTrieNodes";
+                }
+                if (keyword.size() > kMaxKeywordLength) {
+                    throw "SCPI keyword too long, raise kMaxKeywordLength";
+                }
+                child = static_cast<int>(trie.size++);
+                trie.nodes[child].keyword = keyword;
+                for (std::size_t i = 0; i < keyword.size(); ++i) {
+                    trie.nodes[child].upper[i] = to_upper(keyword[i]);
+                }
+                trie.nodes[child].long_length = static_cast<std::uint8_t>(keyword.size());
+                trie.nodes[child].short_length = short_length(keyword);
+                trie.nodes[child].next_sibling = trie.nodes[node].first_child;
+                trie.nodes[node].first_child = static_cast<std::int8_t>(child);
+            }
+            node = static_cast<std::size_t>(child);
+        }
+        (query ? trie.nodes[node].query : trie.nodes[node].command) = pattern.command;
+    }
+    return trie;
+}
+
+inline constexpr Trie kTrie = build_trie();
+
+constexpr std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+} // namespace detail
+
+// Single pass: walks the trie keyword by keyword while scanning the header
+constexpr ParsedCommand parse(std::string_view line) {
+    ParsedCommand result;
+    const std::size_t n = line.size();
+    std::size_t i = 0;
+    while (i < n && detail::is_space(line[i])) {
+        ++i;
+    }
+    const std::size_t header_start = i;
+    if (i < n && line[i] == ':') {
+        ++i;
+    }
+
+    std::size_t node = 0;
+    bool matched = true;
+    while (true) {
+        const std::size_t start = i;
+        while (i < n && line[i] != ':' && line[i] != '?' && !detail::is_space(line[i])) {
+            ++i;
+        }
+        if (matched) {
+            std::string_view keyword = line.substr(start, i - start);
+            int child = detail::kTrie.nodes[node].first_child;
+            while (child >= 0 && !detail::keyword_matches(detail::kTrie.nodes[child], keyword)) {
+                child = detail::kTrie.nodes[child].next_sibling;
+            }
+            matched = child >= 0;
+            node = matched ? static_cast<std::size_t>(child) : 0;
+        }
+        if (i < n && line[i] == ':') {
+            ++i;
+            continue;
+        }
+        break;
+    }
+    if (i < n && line[i] == '?') {
+        result.query = true;
+        ++i;
+    }
+    // Anything glued to the header after '?' makes it unknown
+    while (i < n && !detail::is_space(line[i])) {
+        matched = false;
+        ++i;
+    }
+
+    result.header = line.substr(header_start, i - header_start);
+    result.args = detail::trim(line.substr(i));
+    if (matched && node != 0) {
+        const detail::TrieNode& leaf = detail::kTrie.nodes[node];
+        result.command = result.query ? leaf.query : leaf.command;
+    }
+    return result;
+}
+
+static_assert(parse(":rout:path? 3").command == Command::RoutePath, "short form query");
+static_assert(parse("Switch:Select SW1 2").command == Command::SwitchSelect, "long form, mixed case");
+static_assert(parse("SWITCH:INFO 2").command == Command::Unknown, "INFO is query only");
+static_assert(parse("*opc?").command == Command::OperationComplete, "common command");
+static_assert(parse("STATE?").command == Command::State, "single keyword query");
+
+// Pops the next argument off args; arguments are separated by whitespace or commas
+constexpr std::string_view next_argument(std::string_view& args) {
+    std::size_t start = 0;
+    while (start < args.size() && (detail::is_space(args[start]) || args[start] == ',')) {
+        ++start;
+    }
+    std::size_t end = start;
+    while (end < args.size() && !detail::is_space(args[end]) && args[end] != ',') {
+        ++end;
+    }
+    std::string_view arg = args.substr(start, end - start);
+    args.remove_prefix(end);
+    return arg;
+}
+
+// Calls f(const ParsedCommand&) for each command of a program message such as
+// "PATH:SELECT 3;:SWITCH:SELECT SW1 2;:SWITCH:INFO? 1". As in SCPI, a header
+// after ';' without a leading ':' is relative to the previous command's
+// header path, so "SWIT:SEL SW1 2;SEL SW2 1" selects both switches.
+template <typename F>
+void for_each_command(std::string_view message, F&& f) {
+    std::string path;      // previous header up to its last ':', e.g. "SWIT:"
+    std::string resolved;  // relative header expanded with path
+    while (true) {
+        std::size_t semicolon = message.find(';');
+        std::string_view unit = detail::trim(message.substr(0, semicolon));
+        if (!unit.empty()) {
+            ParsedCommand cmd;
+            if (!path.empty() && unit.front() != ':' && unit.front() != '*') {
+                resolved.assign(path);
+                resolved.append(unit.data(), unit.size());
+                cmd = parse(resolved);
+            } else {
+                cmd = parse(unit);
+            }
+
+            // Common commands (*OPC?, ...) leave the current path alone
+            std::string_view header = cmd.header;
+            if (!header.empty() && header.front() != '*') {
+                if (header.front() == ':') {
+                    header.remove_prefix(1);
+                }
+                std::size_t colon = header.rfind(':');
+                path.assign(header.data(), colon == std::string_view::npos ? 0 : colon + 1);
+            }
+            f(static_cast<const ParsedCommand&>(cmd));
+        }
+        if (semicolon == std::string_view::npos) {
+            break;
+        }
+        message.remove_prefix(semicolon + 1);
+    }
+}
+
+// Whole-token integer conversion; false on empty input, junk or overflow
+template <typename Int>
+bool parse_number(std::string_view text, Int& out) {
+    static_assert(std::is_integral<Int>::value, "parse_number needs an integer type");
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && ptr == text.data() + text.size() && !text.empty();
+}
+
+} // namespace scpi
+
+#endif
@@ -0,0 +1,377 @@
+#include "scpi_server.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kReadChunk = 4096;
+
+// A client that sends this much without a newline is dropped
+constexpr std::size_t kMaxLineLength = 64 * 1024;
+
+// Stop reading from a session whose replies pile up unread, or whose
+// commands pile up unexecuted behind a parked *OPC?; reading resumes once
+// the backlog drains
+constexpr std::size_t kMaxPendingOutput = 1024 * 1024;
+constexpr std::size_t kMaxPendingUnits = 4096;
+
+} // namespace
+
+ScpiServer::ScpiServer(Execute execute)
+    : execute_(std::move(execute)), listen_fd_(-1), epoll_fd_(-1), wake_fd_(-1), running_(false) {}
+
+ScpiServer::~ScpiServer() {
+    stop();
+}
+
+#ifndef __linux__
+
+bool ScpiServer::listen_tcp(const std::string&, int) {
+    Logger::instance().warn("SCPI socket server needs epoll and is only available on Linux");
+    return false;
+}
+
+void ScpiServer::stop() {}
+void ScpiServer::run() {}
+void ScpiServer::accept_clients() {}
+void ScpiServer::receive(Session&) {}
+void ScpiServer::split_lines(Session&) {}
+void ScpiServer::execute(Session&) {}
+bool ScpiServer::flush(Session&) { return false; }
+bool ScpiServer::backlogged(const Session&) { return false; }
+bool ScpiServer::finished(const Session&) { return true; }
+void ScpiServer::update_interest(Session&) {}
+void ScpiServer::close_session(int) {}
+int ScpiServer::next_timeout_ms() const { return -1; }
+
+#else
+
+bool ScpiServer::listen_tcp(const std::string& host, int port) {
+    if (running_) {
+        Logger::instance().warn("SCPI server is already listening");
+        return false;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        Logger::instance().error("SCPI server: cannot resolve host", {{"host", host}});
+        return false;
+    }
+    int fd = socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, result->ai_protocol);
+    int one = 1;
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (fd < 0 || bind(fd, result->ai_addr, result->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+        Logger::instance().error("SCPI server: cannot listen", {{"host", host}, {"port", port},
+                                                                {"error", std::strerror(errno)}});
+        if (fd >= 0) {
+            close(fd);
+        }
+        freeaddrinfo(result);
+        return false;
+    }
+    freeaddrinfo(result);
+
+    listen_fd_ = fd;
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+    running_ = true;
+    loop_ = std::thread(&ScpiServer::run, this);
+    Logger::instance().info("SCPI socket server listening", {{"host", host}, {"port", port}});
+    return true;
+}
+
+void ScpiServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+    loop_.join();
+
+    for (auto& entry : sessions_) {
+        close(entry.first);
+    }
+    sessions_.clear();
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+}
+
+void ScpiServer::run() {
+    epoll_event events[64];
+    while (running_) {
+        int n = epoll_wait(epoll_fd_, events, 64, next_timeout_ms());
+        if (n < 0 && errno != EINTR) {
+            Logger::instance().error("SCPI server: epoll_wait failed", {{"error", std::strerror(errno)}});
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                continue;
+            }
+            if (fd == listen_fd_) {
+                accept_clients();
+                continue;
+            }
+            auto it = sessions_.find(fd);
+            if (it == sessions_.end()) {
+                continue;
+            }
+            Session& session = *it->second;
+            if (events[i].events & EPOLLOUT) {
+                // Output drained: resume a session held back by kMaxPendingOutput
+                bool alive = flush(session);
+                if (alive) {
+                    execute(session);
+                    alive = flush(session);
+                }
+                if (!alive || finished(session)) {
+                    close_session(fd);
+                    continue;
+                }
+            }
+            if (events[i].events & EPOLLIN) {
+                receive(session);  // may close the session
+            } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                close_session(fd);  // reported even while not reading; nothing more can be sent
+            }
+        }
+
+        // Sessions parked in *OPC? whose writes have settled by now
+        auto now = Clock::now();
+        std::vector<int> due;
+        for (auto& entry : sessions_) {
+            if (entry.second->parked && entry.second->pending <= now) {
+                due.push_back(entry.first);
+            }
+        }
+        for (int fd : due) {
+            Session& session = *sessions_[fd];
+            execute(session);
+            if (!flush(session) || finished(session)) {
+                close_session(fd);
+            }
+        }
+    }
+}
+
+void ScpiServer::accept_clients() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;  // EAGAIN: backlog drained
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto session = std::make_unique<Session>();
+        session->fd = fd;
+        session->pending = Clock::now();
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        sessions_[fd] = std::move(session);
+        Logger::instance().debug("SCPI session opened", {{"fd", fd}, {"sessions", sessions_.size()}});
+    }
+}
+
+// Reads while the session keeps up: a client that sends faster than it
+// reads its replies is left in the socket buffer until execute() catches up
+void ScpiServer::receive(Session& session) {
+    const int fd = session.fd;
+    char buffer[kReadChunk];
+    while (!session.peer_closed && !backlogged(session)) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            session.rx.append(buffer, static_cast<std::size_t>(n));
+            split_lines(session);
+            if (session.rx.size() > kMaxLineLength) {
+                Logger::instance().warn("SCPI session sent an overlong line, closing", {{"fd", fd}});
+                close_session(fd);
+                return;
+            }
+            execute(session);
+            if (!flush(session)) {
+                close_session(fd);
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0) {
+            close_session(fd);  // reset: replies cannot be delivered
+            return;
+        }
+        // Half close: answer what arrived, including a parked *OPC?, then close
+        session.peer_closed = true;
+    }
+
+    execute(session);
+    if (!flush(session) || finished(session)) {
+        close_session(fd);
+    }
+}
+
+// Split complete lines into command units; a line may be a compound message
+void ScpiServer::split_lines(Session& session) {
+    std::size_t start = 0;
+    std::size_t newline;
+    while ((newline = session.rx.find('\n', start)) != std::string::npos) {
+        std::string_view line(session.rx.data() + start, newline - start);
+        std::size_t first = session.units.size();
+        scpi::for_each_command(line, [&session](const scpi::ParsedCommand& cmd) {
+            std::string text(cmd.header);
+            if (!cmd.args.empty()) {
+                text += ' ';
+                text.append(cmd.args.data(), cmd.args.size());
+            }
+            session.units.push_back({std::move(text), false});
+        });
+        if (session.units.size() > first) {
+            session.units.back().ends_line = true;
+        }
+        start = newline + 1;
+    }
+    session.rx.erase(0, start);
+}
+
+void ScpiServer::execute(Session& session) {
+    while (!session.units.empty() && session.tx.size() - session.tx_offset < kMaxPendingOutput) {
+        Unit& unit = session.units.front();
+        scpi::ParsedCommand cmd = scpi::parse(unit.text);
+
+        std::string reply;
+        if (cmd.command == scpi::Command::OperationComplete) {
+            if (session.pending > Clock::now()) {
+                session.parked = true;  // resumed by run() once the writes have settled
+                return;
+            }
+            session.parked = false;
+            reply = "1";
+        } else {
+            reply = execute_(cmd, session.pending);
+        }
+
+        if (!session.reply.empty()) {
+            session.reply += ';';
+        }
+        session.reply += reply;
+        if (unit.ends_line) {
+            session.tx += session.reply;
+            session.tx += '\n';
+            session.reply.clear();
+        }
+        session.units.pop_front();
+    }
+}
+
+bool ScpiServer::flush(Session& session) {
+    while (session.tx_offset < session.tx.size()) {
+        ssize_t n = send(session.fd, session.tx.data() + session.tx_offset,
+                         session.tx.size() - session.tx_offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        session.tx_offset += static_cast<std::size_t>(n);
+    }
+    if (session.tx_offset == session.tx.size()) {
+        session.tx.clear();
+        session.tx_offset = 0;
+    }
+    update_interest(session);
+    return true;
+}
+
+bool ScpiServer::backlogged(const Session& session) {
+    return session.units.size() >= kMaxPendingUnits || session.tx.size() - session.tx_offset >= kMaxPendingOutput;
+}
+
+// Peer has half closed and every command it sent has been answered and sent
+bool ScpiServer::finished(const Session& session) {
+    return session.peer_closed && session.units.empty() && session.tx_offset == session.tx.size();
+}
+
+void ScpiServer::update_interest(Session& session) {
+    bool want_read = !session.peer_closed && !backlogged(session);
+    bool want_write = session.tx_offset < session.tx.size();
+    if (want_read == session.want_read && want_write == session.want_write) {
+        return;
+    }
+    session.want_read = want_read;
+    session.want_write = want_write;
+    epoll_event ev{};
+    ev.events = (want_read ? EPOLLIN : 0u) | (want_write ? EPOLLOUT : 0u);
+    ev.data.fd = session.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, session.fd, &ev);
+}
+
+void ScpiServer::close_session(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    sessions_.erase(fd);
+    Logger::instance().debug("SCPI session closed", {{"fd", fd}, {"sessions", sessions_.size()}});
+}
+
+// Wakes the loop in time for the earliest parked *OPC?
+int ScpiServer::next_timeout_ms() const {
+    bool any = false;
+    Clock::time_point earliest = Clock::time_point::max();
+    for (const auto& entry : sessions_) {
+        if (entry.second->parked) {
+            any = true;
+            earliest = std::min(earliest, entry.second->pending);
+        }
+    }
+    if (!any) {
+        return -1;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(earliest - Clock::now()).count();
+    return static_cast<int>(std::max<long long>(wait + 1, 0));  // round up: never wake early
+}
+
+#endif
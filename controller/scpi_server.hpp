@@ -0,0 +1,82 @@
+#ifndef SCPI_SERVER_HPP
+#define SCPI_SERVER_HPP
+
+#include "scpi_parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Raw SCPI over TCP (port 5025 by convention), in the dialect of
+// Ramiro/fake_fpga: newline-terminated commands, one reply line per command
+// line ("OK", "ERR,<reason>" or the query result). Units of a compound
+// message ("PATH:SEL 3;*OPC?") are answered on one line joined by ';'.
+//
+// One epoll thread serves every session (Linux only; listen fails
+// elsewhere). Commands are pipelined: everything buffered on a session is
+// executed in order. *OPC? is handled here: it parks only its own session
+// until that session's relay writes have settled, the loop keeps serving
+// the others.
+class ScpiServer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Executes one command and returns its reply (without terminator).
+    // pending is per session: the settle deadline of the writes issued so far.
+    using Execute = std::function<std::string(const scpi::ParsedCommand& cmd, Clock::time_point& pending)>;
+
+    explicit ScpiServer(Execute execute);
+    ~ScpiServer();
+
+    ScpiServer(const ScpiServer&) = delete;
+    ScpiServer& operator=(const ScpiServer&) = delete;
+
+    bool listen_tcp(const std::string& host, int port);
+    void stop();
+
+private:
+    struct Unit {
+        std::string text;   // one command, relative headers already resolved
+        bool ends_line;     // last unit of its line: flush the reply line after it
+    };
+
+    struct Session {
+        int fd = -1;
+        std::string rx;
+        std::string tx;
+        std::size_t tx_offset = 0;
+        std::deque<Unit> units;
+        std::string reply;               // replies of the current line so far
+        Clock::time_point pending;       // settle deadline of this session's writes
+        bool parked = false;             // waiting in *OPC? until pending
+        bool peer_closed = false;        // peer sent FIN; closed once everything is answered
+        bool want_read = true;           // EPOLLIN registered
+        bool want_write = false;         // EPOLLOUT registered
+    };
+
+    void run();
+    void accept_clients();
+    void receive(Session& session);
+    void split_lines(Session& session);
+    void execute(Session& session);
+    bool flush(Session& session);
+    static bool backlogged(const Session& session);
+    static bool finished(const Session& session);
+    void update_interest(Session& session);
+    void close_session(int fd);
+    int next_timeout_ms() const;
+
+    Execute execute_;
+    int listen_fd_;
+    int epoll_fd_;
+    int wake_fd_;
+    std::atomic<bool> running_;
+    std::thread loop_;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions_;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "shadow_registers.hpp"
+
+bool ShadowRegisters::claim(std::uint32_t address, std::uint8_t value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // find first: emplace allocates its node before it sees the key exists
+    auto it = values_.find(address);
+    if (it == values_.end()) {
+        values_.emplace(address, value);
+        return true;
+    }
+    if (it->second == value) {
+        return false;
+    }
+    it->second = value;
+    return true;
+}
+
+void ShadowRegisters::invalidate(std::uint32_t address) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_.erase(address);
+}
+
+bool ShadowRegisters::lookup(std::uint32_t address, std::uint8_t& value) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(address);
+    if (it == values_.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+std::size_t ShadowRegisters::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return values_.size();
+}
@@ -0,0 +1,32 @@
+#ifndef SHADOW_REGISTERS_HPP
+#define SHADOW_REGISTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Last value written to each AXI switch register. Lets the controller skip
+// writes that would not change the chassis: no bus transaction, no relay
+// actuation, no settle time. Registers never written (or whose write
+// failed) are unknown and always written.
+class ShadowRegisters {
+public:
+    // Records value as the register's target and returns true if it has to
+    // be written, false if the register already holds it
+    bool claim(std::uint32_t address, std::uint8_t value);
+
+    // Forget a register after a failed write so the next claim rewrites it
+    void invalidate(std::uint32_t address);
+
+    // False if the register's value is unknown
+    bool lookup(std::uint32_t address, std::uint8_t& value) const;
+
+    std::size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::uint32_t, std::uint8_t> values_;
+};
+
+#endif
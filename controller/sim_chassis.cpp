@@ -0,0 +1,220 @@
+#include "sim_chassis.hpp"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint32_t kMagic = 0x43504653;  // "SFPC"
+constexpr std::uint32_t kLayoutVersion = 1;
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        SimChassis::Clock::now().time_since_epoch()).count();
+}
+
+std::size_t align8(std::size_t offset) {
+    return (offset + 7) & ~static_cast<std::size_t>(7);
+}
+
+static_assert(std::atomic<std::uint8_t>::is_always_lock_free &&
+              std::atomic<std::uint32_t>::is_always_lock_free &&
+              std::atomic<std::int64_t>::is_always_lock_free &&
+              std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock free to work across processes");
+
+} // namespace
+
+// Start of the segment, followed by the register, odometer and busy arrays
+struct SimChassis::Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t base;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::atomic<std::int64_t> settle_ns;
+    std::atomic<std::uint64_t> writes;
+    std::atomic<std::uint64_t> actuations;
+    std::atomic<std::uint64_t> overlapped;
+};
+
+std::size_t SimChassis::layout_size(std::size_t window) {
+    std::size_t offset = align8(sizeof(Header) + window);
+    offset += align8(window * sizeof(std::uint32_t));
+    return offset + window * sizeof(std::int64_t);
+}
+
+SimChassis::SimChassis(std::string name, void* mapping, std::size_t mapping_size)
+    : name_(std::move(name)), mapping_(mapping), mapping_size_(mapping_size) {
+    auto* bytes = static_cast<unsigned char*>(mapping);
+    header_ = reinterpret_cast<Header*>(bytes);
+    base_ = header_->base;
+    size_ = static_cast<std::size_t>(header_->size);
+    std::size_t offset = sizeof(Header);
+    registers_ = reinterpret_cast<std::atomic<std::uint8_t>*>(bytes + offset);
+    offset = align8(offset + size_);
+    odometers_ = reinterpret_cast<std::atomic<std::uint32_t>*>(bytes + offset);
+    offset += align8(size_ * sizeof(std::uint32_t));
+    busy_until_ = reinterpret_cast<std::atomic<std::int64_t>*>(bytes + offset);
+}
+
+#ifdef _WIN32
+
+std::unique_ptr<SimChassis> SimChassis::create(const std::string&, std::uint32_t, std::size_t, Clock::duration,
+                                               std::string& error) {
+    error = "the shared-memory chassis needs POSIX shared memory";
+    return nullptr;
+}
+
+std::unique_ptr<SimChassis> SimChassis::attach(const std::string&, std::string& error) {
+    error = "the shared-memory chassis needs POSIX shared memory";
+    return nullptr;
+}
+
+bool SimChassis::remove(const std::string&) {
+    return false;
+}
+
+SimChassis::~SimChassis() = default;
+
+#else
+
+std::unique_ptr<SimChassis> SimChassis::create(const std::string& name, std::uint32_t base, std::size_t size,
+                                               Clock::duration settle_time, std::string& error) {
+    if (size == 0) {
+        error = "register window size is 0";
+        return nullptr;
+    }
+    shm_unlink(name.c_str());  // stale segment from an earlier run
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        error = name + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    std::size_t mapping_size = layout_size(size);
+    if (ftruncate(fd, static_cast<off_t>(mapping_size)) < 0) {
+        error = name + ": " + std::strerror(errno);
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = name + ": mmap failed: " + std::strerror(errno);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    // The arrays are zero filled by ftruncate, which is a valid zero for lock-free atomics
+    Header* header = new (mapping) Header();
+    header->base = base;
+    header->size = size;
+    header->settle_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(settle_time).count());
+    header->version = kLayoutVersion;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kMagic;  // attach() checks this last
+    return std::unique_ptr<SimChassis>(new SimChassis(name, mapping, mapping_size));
+}
+
+std::unique_ptr<SimChassis> SimChassis::attach(const std::string& name, std::string& error) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        error = name + ": " + std::strerror(errno) + " (is sim_chassis running?)";
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header)) {
+        error = name + ": not a chassis segment";
+        close(fd);
+        return nullptr;
+    }
+    std::size_t mapping_size = static_cast<std::size_t>(info.st_size);
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = name + ": mmap failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    const Header* header = static_cast<const Header*>(mapping);
+    if (header->magic != kMagic || header->version != kLayoutVersion ||
+        layout_size(static_cast<std::size_t>(header->size)) > mapping_size) {
+        error = name + ": not a chassis segment, or a different layout version";
+        munmap(mapping, mapping_size);
+        return nullptr;
+    }
+    return std::unique_ptr<SimChassis>(new SimChassis(name, mapping, mapping_size));
+}
+
+bool SimChassis::remove(const std::string& name) {
+    return shm_unlink(name.c_str()) == 0;
+}
+
+SimChassis::~SimChassis() {
+    munmap(mapping_, mapping_size_);
+}
+
+#endif
+
+bool SimChassis::write(std::uint32_t addr, std::uint8_t value) {
+    if (!contains(addr)) {
+        return false;
+    }
+    std::size_t index = addr - base_;
+    header_->writes.fetch_add(1, std::memory_order_relaxed);
+    if (registers_[index].exchange(value, std::memory_order_acq_rel) == value) {
+        return true;  // relay already there, nothing moves
+    }
+    std::int64_t now = now_ns();
+    if (busy_until_[index].load(std::memory_order_relaxed) > now) {
+        header_->overlapped.fetch_add(1, std::memory_order_relaxed);
+    }
+    busy_until_[index].store(now + header_->settle_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    odometers_[index].fetch_add(1, std::memory_order_relaxed);
+    header_->actuations.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SimChassis::read(std::uint32_t addr, std::uint8_t& value) const {
+    if (!contains(addr)) {
+        return false;
+    }
+    value = registers_[addr - base_].load(std::memory_order_acquire);
+    return true;
+}
+
+bool SimChassis::odometer(std::uint32_t addr, std::uint32_t& count) const {
+    if (!contains(addr)) {
+        return false;
+    }
+    count = odometers_[addr - base_].load(std::memory_order_relaxed);
+    return true;
+}
+
+bool SimChassis::busy(std::uint32_t addr) const {
+    return contains(addr) && busy_until_[addr - base_].load(std::memory_order_relaxed) > now_ns();
+}
+
+SimChassis::Clock::duration SimChassis::settle_time() const {
+    return std::chrono::nanoseconds(header_->settle_ns.load(std::memory_order_relaxed));
+}
+
+void SimChassis::set_settle_time(Clock::duration settle_time) {
+    header_->settle_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(settle_time).count(),
+                             std::memory_order_relaxed);
+}
+
+SimChassis::Stats SimChassis::stats() const {
+    Stats stats;
+    stats.writes = header_->writes.load(std::memory_order_relaxed);
+    stats.actuations = header_->actuations.load(std::memory_order_relaxed);
+    stats.overlapped = header_->overlapped.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,79 @@
+#ifndef SIM_CHASSIS_HPP
+#define SIM_CHASSIS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Simulated switch chassis in a POSIX shared-memory segment (shm_open
+// name such as "/sfp_chassis"), the C++ stand-in for Ramiro/fake_fpga. The
+// segment holds the register window at the paths.json AXI addresses plus,
+// per address, an actuation odometer and the time the relay is busy until.
+// Any number of processes can map it: the controller writes through
+// RegisterMap ("chassis:/sfp_chassis"), sim_chassis serves and monitors it,
+// and a test can attach and check what landed.
+//
+// Everything in the segment is a lock-free atomic, so writers in different
+// processes need no lock. A write that changes a register is an actuation:
+// the odometer counts it and the relay is busy for the settle time; a write
+// that lands while the relay is still busy is counted as overlapped (the
+// controller's SwitchScheduler should keep that at zero).
+class SimChassis {
+public:
+    using Clock = std::chrono::steady_clock;  // CLOCK_MONOTONIC, the same in every process
+
+    struct Stats {
+        std::uint64_t writes = 0;
+        std::uint64_t actuations = 0;
+        std::uint64_t overlapped = 0;
+    };
+
+    // Creates (or replaces) the segment; registers start at zero
+    static std::unique_ptr<SimChassis> create(const std::string& name, std::uint32_t base, std::size_t size,
+                                              Clock::duration settle_time, std::string& error);
+    // Maps a segment some other process created
+    static std::unique_ptr<SimChassis> attach(const std::string& name, std::string& error);
+    static bool remove(const std::string& name);
+
+    ~SimChassis();
+
+    SimChassis(const SimChassis&) = delete;
+    SimChassis& operator=(const SimChassis&) = delete;
+
+    // False if addr is outside the window
+    bool write(std::uint32_t addr, std::uint8_t value);
+    bool read(std::uint32_t addr, std::uint8_t& value) const;
+    bool odometer(std::uint32_t addr, std::uint32_t& count) const;
+    bool busy(std::uint32_t addr) const;
+
+    Clock::duration settle_time() const;
+    void set_settle_time(Clock::duration settle_time);
+    Stats stats() const;
+
+    const std::string& name() const { return name_; }
+    std::uint32_t base() const { return base_; }
+    std::size_t size() const { return size_; }
+
+private:
+    struct Header;
+
+    SimChassis(std::string name, void* mapping, std::size_t mapping_size);
+    static std::size_t layout_size(std::size_t window);
+
+    bool contains(std::uint32_t addr) const { return addr >= base_ && addr - base_ < size_; }
+
+    std::string name_;
+    void* mapping_;
+    std::size_t mapping_size_;
+    Header* header_;
+    std::uint32_t base_;
+    std::size_t size_;
+    std::atomic<std::uint8_t>* registers_;
+    std::atomic<std::uint32_t>* odometers_;
+    std::atomic<std::int64_t>* busy_until_;  // Clock nanoseconds
+};
+
+#endif
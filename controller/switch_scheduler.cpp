@@ -0,0 +1,93 @@
+#include "switch_scheduler.hpp"
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+SwitchScheduler::SwitchScheduler(Clock::duration settle_time)
+    : settle_time_(settle_time),
+      idle_at_(Clock::now()),
+      worker_(&SwitchScheduler::worker, this) {}
+
+SwitchScheduler::~SwitchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+SwitchScheduler::Clock::time_point SwitchScheduler::submit(const std::string& relay, Write write) {
+    Clock::time_point now = Clock::now();
+    Clock::time_point settled_at;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Relay& state = relays_[relay];
+        Clock::time_point start = std::max(now, state.settled_at);
+        settled_at = start + settle_time_;
+        state.settled_at = settled_at;
+        idle_at_ = std::max(idle_at_, settled_at);
+
+        // Busy relay, or earlier writes to it still queued: keep them in order.
+        // write is queued as is, so a write that fits std::function's local
+        // buffer is deferred without allocating (once jobs_ has grown).
+        if (start > now || state.deferred > 0) {
+            ++state.deferred;
+            schedule(start, std::move(write), &state);
+            return settled_at;
+        }
+    }
+    write();
+    return settled_at;
+}
+
+SwitchScheduler::Clock::time_point SwitchScheduler::idle_at() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_at_;
+}
+
+std::shared_future<void> SwitchScheduler::completion(Clock::time_point settled_at) {
+    auto done = std::make_shared<std::promise<void>>();
+    std::shared_future<void> future = done->get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        schedule(settled_at, [done]() { done->set_value(); }, nullptr);
+    }
+    return future;
+}
+
+// Caller holds mutex_. relays_ nodes never move, so jobs point at them.
+void SwitchScheduler::schedule(Clock::time_point due, std::function<void()> run, Relay* relay) {
+    bool earliest = jobs_.empty() || due < jobs_.top().due;
+    jobs_.push(Job{due, sequence_++, std::move(run), relay});
+    if (earliest) {
+        wake_.notify_one();
+    }
+}
+
+void SwitchScheduler::worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (jobs_.empty()) {
+            if (stopping_) {
+                return;
+            }
+            wake_.wait(lock);
+            continue;
+        }
+        Clock::time_point due = jobs_.top().due;
+        if (Clock::now() < due) {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+        std::function<void()> run = std::move(const_cast<Job&>(jobs_.top()).run);
+        Relay* relay = jobs_.top().relay;
+        jobs_.pop();
+        lock.unlock();
+        run();
+        lock.lock();
+        if (relay != nullptr) {
+            --relay->deferred;
+        }
+    }
+}
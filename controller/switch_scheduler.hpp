@@ -0,0 +1,75 @@
+#ifndef SWITCH_SCHEDULER_HPP
+#define SWITCH_SCHEDULER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Serialises register writes per relay while letting different relays move
+// at the same time. A relay is busy for settle_time after each write (the
+// fake_fpga models 150 ms); a write to a busy relay is deferred to the
+// scheduler thread until the relay has settled, a write to an idle relay
+// runs at once on the caller's thread. Settle time is fixed, so the moment
+// a write will have settled is known when it is submitted and a two-switch
+// route change is ready after max(settle) instead of sum(settle).
+class SwitchScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Write = std::function<void()>;
+
+    explicit SwitchScheduler(Clock::duration settle_time);
+    ~SwitchScheduler();  // runs the writes still queued, at their due time
+
+    SwitchScheduler(const SwitchScheduler&) = delete;
+    SwitchScheduler& operator=(const SwitchScheduler&) = delete;
+
+    // Queues write on relay (a component id such as "switch1") and returns
+    // the time at which it will have settled
+    Clock::time_point submit(const std::string& relay, Write write);
+
+    // Time at which every write submitted so far will have settled
+    Clock::time_point idle_at() const;
+
+    // *OPC?: resolves once settled_at has passed and every write due by then has run
+    std::shared_future<void> completion(Clock::time_point settled_at);
+
+    Clock::duration settle_time() const { return settle_time_; }
+
+private:
+    struct Relay {
+        Clock::time_point settled_at;  // end of the last write submitted to it
+        int deferred = 0;              // writes waiting on the scheduler thread
+    };
+
+    struct Job {
+        Clock::time_point due;
+        unsigned long long sequence;  // jobs due at the same time run in submission order
+        std::function<void()> run;
+        Relay* relay;                 // deferred write to release, nullptr for completions
+        bool operator>(const Job& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    void schedule(Clock::time_point due, std::function<void()> run, Relay* relay);
+    void worker();
+
+    const Clock::duration settle_time_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unordered_map<std::string, Relay> relays_;
+    Clock::time_point idle_at_;
+    std::priority_queue<Job, std::vector<Job>, std::greater<Job>> jobs_;
+    unsigned long long sequence_ = 0;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+#endif
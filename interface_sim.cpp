@@ -1,42 +1,59 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <nlohmann/json.hpp>  // Assuming nlohmann/json is installed (via vcpkg install nlohmann-json)
+#include "controller/odometer_store.hpp"
+#include "controller/register_map.hpp"
+#include "controller/scpi_parser.hpp"
 
-// Needs to be compiled with C++11, use: g++ interface_sim.cpp -I./include -std=c++11 -o interface_sim to compile,.\interface_sim.exe to run
+// Needs to be compiled with C++17, use: g++ interface_sim.cpp controller/register_map.cpp controller/sim_chassis.cpp controller/odometer_store.cpp controller/logger.cpp -I./include -std=c++17 -pthread -lz -o interface_sim to compile,.\interface_sim.exe to run
 
-// Mock hardware function to simulate AXI write
+// Simulated AXI GPIO window covering the addresses in the configuration below
+std::unique_ptr<RegisterMap> registers;
+
+// AXI write into the simulated registers, read back to show what landed
 int write_to_axi(uint32_t addr, uint8_t value) {
-    std::cout << "Mock AXI write: Address = " << addr << ", Value = " << static_cast<int>(value) << std::endl;
+    uint8_t readback = 0;
+    if (!registers->write8(addr, value) || !registers->read8(addr, readback)) {
+        std::cout << "AXI write outside the register window: Address = " << addr << std::endl;
+        return 1;
+    }
+    std::cout << "AXI write: Address = " << addr << ", Value = " << static_cast<int>(value)
+              << ", Readback = " << static_cast<int>(readback) << std::endl;
     return 0;  // Success
 }
 
-// Mock function to simulate reading odometer
-uint32_t read_odometer() {
-    std::cout << "Mock odometer read: Returning simulated value 42" << std::endl;
-    return 42;  // Simulated value
+// Actuation counts, as sfp_server keeps them (in memory only here)
+OdometerStore odometers;
+
+// Counts a switch move the way sfp_server does: only when the register changes position.
+// component_id "switch1" is odometer slot 0.
+uint64_t count_actuation(const std::string& component_id, uint8_t previous, uint8_t gpio_value) {
+    int slot = component_id.rfind("switch", 0) == 0 ? std::atoi(component_id.c_str() + 6) - 1 : -1;
+    return previous == gpio_value ? odometers.total(slot) : odometers.record(slot, gpio_value);
 }
 
 // Function to parse and process SCPI command with JSON validation
 void process_scpi_command(const std::string& scpi_cmd, const std::string& component_id, const nlohmann::json& config_json) {
-    // Validate SCPI command (basic check: must start with "PATH:SELECT ")
-    if (scpi_cmd.rfind("PATH:SELECT ", 0) != 0) {
+    // Validate SCPI command (must be PATH:SELECT, short form PATH:SEL accepted)
+    scpi::ParsedCommand cmd = scpi::parse(scpi_cmd);
+    if (cmd.command != scpi::Command::PathSelect) {
         std::cout << "Invalid command format. Must be 'PATH:SELECT <number>'" << std::endl;
         return;
     }
 
     // Extract the path number (e.g., "3" from "PATH:SELECT 3")
-    std::string path_str = scpi_cmd.substr(12); // Skip "PATH:SELECT "
+    std::string_view args = cmd.args;
     int id_num;
-    try {
-        id_num = std::stoi(path_str);
-        if (id_num < 0 || id_num > 255) { // Assume 8-bit paths (0-255)
-            std::cout << "Invalid path number. Must be 0-255" << std::endl;
-            return;
-        }
-    } catch (...) {
+    if (!scpi::parse_number(scpi::next_argument(args), id_num)) {
         std::cout << "Invalid path number format" << std::endl;
         return;
     }
+    if (id_num < 0 || id_num > 255) { // Assume 8-bit paths (0-255)
+        std::cout << "Invalid path number. Must be 0-255" << std::endl;
+        return;
+    }
 
     // Validate against JSON configuration (assume JSON has a "paths" array with id, component_id, address, gpio_value)
     if (!config_json.contains("paths") || !config_json["paths"].is_array()) {
@@ -52,8 +69,10 @@ void process_scpi_command(const std::string& scpi_cmd, const std::string& compon
             uint32_t addr = path["address"].get<uint32_t>(); // Assume JSON has "address" field
             uint8_t gpio_value = path["gpio_value"].get<uint8_t>(); // Assume JSON has "gpio_value" field
             // Call mock hardware function
+            uint8_t previous = 0;
+            registers->read8(addr, previous);
             if (write_to_axi(addr, gpio_value) == 0) {
-                uint32_t odometer = read_odometer(); // Call mock read
+                uint64_t odometer = count_actuation(component_id, previous, gpio_value);
                 std::cout << "Success: Path " << id_num << " (" << component_id << ") activated. Odometer: " << odometer << std::endl;
             } else {
                 std::cout << "Mock hardware write failed" << std::endl;
@@ -68,6 +87,13 @@ void process_scpi_command(const std::string& scpi_cmd, const std::string& compon
 }
 
 int main() {
+    std::string error;
+    registers = RegisterMap::open_simulated("", 0x10000000, 0x10000, error);
+    if (!registers) {
+        std::cout << "Cannot map simulated registers: " << error << std::endl;
+        return 1;
+    }
+
     // Simulate receiving a SCPI command (hardcoded for standalone execution)
     std::string scpi_cmd = "PATH:SELECT 3";
 
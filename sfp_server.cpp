@@ -1,194 +1,212 @@
 #include <httplib.h>
 #include <string>
 #include <nlohmann/json.hpp>
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <vector>
+#include <string_view>
+#include "controller/binary_server.hpp"
+#include "controller/command_body.hpp"
+#include "controller/command_core.hpp"
+#include "controller/config_document.hpp"
+#include "controller/config_watcher.hpp"
+#include "controller/event_stream_server.hpp"
+#include "controller/http_settings.hpp"
+#include "controller/scpi_server.hpp"
 
-// Global state to track current path
-int current_path_id = -1; // -1 means no path selected
+// Build: g++ sfp_server.cpp controller/*.cpp -I./include -std=c++17 -pthread -lz -o sfp_server
+// The command path itself is controller/command_core.cpp.
 
-// SCPI driver functions (mocked)
-int write_to_axi(uint32_t addr, uint8_t value) {
-    std::cout << "SCPI Driver: Mock AXI write to address " << addr << " with value " << static_cast<int>(value) << std::endl;
-    return 0;
-}
+// Last serialized GET /config, rebuilt when the route table or the selected path changes
+std::shared_ptr<const ConfigDocument> config_document;
 
-uint32_t read_odometer() {
-    std::cout << "SCPI Driver: Mock odometer read: 42" << std::endl;
-    return 42;
+std::shared_ptr<const ConfigDocument> current_config_document() {
+    std::shared_ptr<const RouteTable> routes = current_routes();
+    int current_path = chassis.current_path();
+    std::shared_ptr<const ConfigDocument> document = std::atomic_load(&config_document);
+    if (!document || !document->matches(routes, current_path)) {
+        document = ConfigDocument::build(std::move(routes), current_path);
+        std::atomic_store(&config_document, document);
+    }
+    return document;
 }
 
-nlohmann::json load_json_from_file(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cout << "Failed to open " << filename << std::endl;
-        return nlohmann::json();
-    }
-    nlohmann::json j;
-    file >> j;
-    return j;
+double elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
 }
 
-void process_scpi_command(const std::string& scpi_cmd) {
-    // Note: SCPI command logging now happens in the endpoint before this function
-    nlohmann::json config_json = load_json_from_file("paths.json");
-    if (config_json.empty()) {
-        std::cout << "Failed to load paths.json" << std::endl;
-        return;
-    }
+// One Server-Sent Events frame
+std::string sse_frame(uint64_t id, const std::string& type, const std::string& data) {
+    std::string frame;
+    EventStreamServer::append_frame(frame, id, type, data);
+    return frame;
+}
 
-    // Handle PATH:SELECT command
-    if (scpi_cmd.rfind("PATH:SELECT ", 0) == 0) {
-        std::string path_str = scpi_cmd.substr(12);
-        int path_num;
-        try {
-            path_num = std::stoi(path_str);
-            if (path_num < 0 || path_num > 255) {
-                std::cout << "Invalid path number" << std::endl;
-                return;
-            }
-        } catch (...) {
-            std::cout << "Invalid path number format" << std::endl;
-            return;
-        }
+// Full chassis state, sent when a watcher connects or has missed events
+std::string sse_state_frame(uint64_t id) {
+    ChassisState::Snapshot state = chassis.snapshot();
+    nlohmann::json full;
+    full["current_path"] = state.current_path;
+    full["state_version"] = state.version;
+    full["switches"] = switches_json(state);
+    return sse_frame(id, "state", full.dump());
+}
 
-        // Update current path state
-        current_path_id = path_num;
-        std::cout << "Current path set to: " << current_path_id << std::endl;
+int main(int argc, char** argv) {
+    logger.info("Starting server...");
 
-        bool path_found = false;
-        if (config_json.contains("paths") && config_json["paths"].is_array()) {
-            for (const auto& path : config_json["paths"]) {
-                if (path["id"].get<int>() == path_num) {
-                    path_found = true;
-                    uint32_t addr = path["address"].get<uint32_t>();
-                    uint8_t gpio_value = path["gpio_value"].get<uint8_t>();
-                    if (write_to_axi(addr, gpio_value) == 0) {
-                        uint32_t odometer = read_odometer();
-                        std::cout << "Path " << path_num << " activated at address " << addr
-                                  << " with GPIO value " << static_cast<int>(gpio_value)
-                                  << ". Odometer: " << odometer << std::endl;
-                    }
-                }
-            }
+    // Verbosity: SFP_LOG_LEVEL at startup, POST /log_level while running
+    if (const char* level_name = std::getenv("SFP_LOG_LEVEL")) {
+        LogLevel level;
+        if (Logger::parse_level(level_name, level)) {
+            logger.set_level(level);
+        } else {
+            logger.warn("Ignoring unknown SFP_LOG_LEVEL", {{"value", level_name}});
         }
+    }
 
-        if (!path_found) {
-            std::cout << "No paths found with id " << path_num << std::endl;
-            current_path_id = -1; // Reset if path not found
-        }
-        return;
+    // HTTP worker pool, keep-alive and limits: SFP_HTTP_* or --http-* flags
+    HttpSettings http_settings;
+    http_settings.load_environment();
+    std::string settings_error;
+    if (!http_settings.parse_arguments(argc, argv, settings_error)) {
+        logger.error("Invalid command line", {{"error", settings_error}});
+        logger.flush();
+        std::cerr << HttpSettings::usage();
+        return 2;
     }
 
-    // Handle SWITCH:SELECT command (with GPIO value parameter, respects current path for address)
-    if (scpi_cmd.rfind("SWITCH:SELECT ", 0) == 0) {
-        std::string params = scpi_cmd.substr(14); // Remove "SWITCH:SELECT "
-        std::istringstream iss(params);
-        std::string switch_str, gpio_str;
-        
-        if (!(iss >> switch_str >> gpio_str)) {
-            std::cout << "Invalid SWITCH:SELECT format. Use: SWITCH:SELECT <switch_id> <gpio_value>" << std::endl;
-            return;
+    // Register backend: SFP_REGISTERS is uio:/dev/uioN, devmem, sim (default),
+    // sim:<file> or chassis:<shm name>, over the window SFP_AXI_BASE / SFP_AXI_SIZE
+    std::string register_spec = "sim";
+    if (const char* spec = std::getenv("SFP_REGISTERS")) {
+        register_spec = spec;
+    }
+    unsigned long long axi_base = 0x10000000;
+    unsigned long long axi_size = 0x10000;
+    if (const char* base = std::getenv("SFP_AXI_BASE")) {
+        axi_base = std::strtoull(base, nullptr, 0);
+    }
+    if (const char* size = std::getenv("SFP_AXI_SIZE")) {
+        axi_size = std::strtoull(size, nullptr, 0);
+    }
+    std::string register_error;
+    axi_registers = RegisterMap::open(register_spec, static_cast<uint32_t>(axi_base),
+                                      static_cast<std::size_t>(axi_size), register_error);
+    if (!axi_registers) {
+        logger.error("Cannot open register backend, falling back to simulated registers",
+                     {{"backend", register_spec}, {"error", register_error}});
+        axi_registers = RegisterMap::open_simulated("", static_cast<uint32_t>(axi_base),
+                                                    static_cast<std::size_t>(axi_size), register_error);
+        if (!axi_registers) {
+            logger.error("Cannot map simulated registers", {{"error", register_error}});
+            logger.flush();
+            return 1;
         }
+    }
+    logger.info("Register backend ready", {{"backend", axi_registers->kind_name()},
+                                           {"source", axi_registers->source()},
+                                           {"base", axi_registers->base()}, {"size", axi_registers->size()}});
 
-        std::string switch_id = switch_str;
-        int gpio_value;
-        try {
-            gpio_value = std::stoi(gpio_str);
-            if (gpio_value < 0 || gpio_value > 255) {
-                std::cout << "Invalid GPIO value. Must be between 0 and 255" << std::endl;
-                return;
-            }
-        } catch (...) {
-            std::cout << "Invalid GPIO value format" << std::endl;
-            return;
+    // Relay odometers survive restarts in SFP_ODOMETER_FILE (default
+    // odometers.dat), synced every SFP_ODOMETER_SYNC_MS (default 1000)
+    std::string odometer_file = "odometers.dat";
+    if (const char* file = std::getenv("SFP_ODOMETER_FILE")) {
+        odometer_file = file;
+    }
+    int odometer_sync_ms = 1000;
+    if (const char* sync_ms = std::getenv("SFP_ODOMETER_SYNC_MS")) {
+        if (!scpi::parse_number(std::string_view(sync_ms), odometer_sync_ms) || odometer_sync_ms <= 0) {
+            logger.warn("Ignoring invalid SFP_ODOMETER_SYNC_MS", {{"value", sync_ms}});
+            odometer_sync_ms = 1000;
         }
+    }
+    std::string odometer_error;
+    if (odometers.open(odometer_file, std::chrono::milliseconds(odometer_sync_ms), odometer_error)) {
+        logger.info("Odometers loaded", {{"file", odometer_file}, {"sequence", odometers.sequence()}});
+    } else {
+        logger.warn("Odometers will not persist", {{"file", odometer_file}, {"error", odometer_error}});
+    }
 
-        // Check if a path is currently selected
-        if (current_path_id == -1) {
-            std::cout << "No path currently selected. Please select a path first before using switch mode." << std::endl;
-            return;
-        }
+    logger.info("Loading route configuration...");
+    publish_routes(RouteTable::load("paths.json", "components_paths.json"));
 
-        std::cout << "Switch ID received: " << switch_id << " with GPIO value: " << gpio_value << " (using path " << current_path_id << " address)" << std::endl;
-        
-        // Map SW1/SW2 to switch1/switch2 format for address lookup
-        std::string component_id;
-        if (switch_id == "SW1") {
-            component_id = "switch1";
-        } else if (switch_id == "SW2") {
-            component_id = "switch2";
-        } else {
-            std::cout << "Unknown switch ID: " << switch_id << std::endl;
-            return;
-        }
+    // Pick up edits to the configuration files without a restart
+    ConfigWatcher config_watcher("paths.json", "components_paths.json", publish_routes);
+    if (!config_watcher.start()) {
+        logger.warn("Configuration hot reload disabled");
+    }
 
-        // Find the switch entry that matches the current path and component
-        bool switch_found = false;
-        if (config_json.contains("paths") && config_json["paths"].is_array()) {
-            for (const auto& path : config_json["paths"]) {
-                // Look for entry that matches both the current path ID and the component
-                if (path["id"].get<int>() == current_path_id && 
-                    path.contains("component_id") && 
-                    path["component_id"].get<std::string>() == component_id) {
-                    
-                    switch_found = true;
-                    uint32_t addr = path["address"].get<uint32_t>();
-                    
-                    if (write_to_axi(addr, static_cast<uint8_t>(gpio_value)) == 0) {
-                        uint32_t odometer = read_odometer();
-                        std::cout << "Switch " << switch_id << " (" << component_id << ") activated at address " << addr
-                                  << " with custom GPIO value " << gpio_value 
-                                  << " from path " << current_path_id
-                                  << ". Odometer: " << odometer << std::endl;
-                    }
-                    break; // Found the exact match for this path
-                }
-            }
+    // Binary command frames for automated sweeps: TCP on SFP_BINARY_PORT
+    // (default 5030, 0 disables), plus a Unix socket if SFP_BINARY_SOCKET is set
+    BinaryServer binary_server(run_binary_command);
+    int binary_port = 5030;
+    if (const char* port = std::getenv("SFP_BINARY_PORT")) {
+        if (!scpi::parse_number(std::string_view(port), binary_port)) {
+            logger.warn("Ignoring invalid SFP_BINARY_PORT", {{"value", port}});
+            binary_port = 5030;
         }
+    }
+    if (binary_port > 0) {
+        binary_server.listen_tcp("127.0.0.1", binary_port);
+    }
+    if (const char* socket_path = std::getenv("SFP_BINARY_SOCKET")) {
+        binary_server.listen_unix(socket_path);
+    }
 
-        if (!switch_found) {
-            std::cout << "Switch " << switch_id << " not found in path " << current_path_id << std::endl;
+    // SCPI over TCP, so instrument drivers and the RFIU UI bridge can talk to
+    // the controller directly: SFP_SCPI_PORT (default 5025, 0 disables)
+    ScpiServer scpi_server(run_socket_command);
+    int scpi_port = 5025;
+    if (const char* port = std::getenv("SFP_SCPI_PORT")) {
+        if (!scpi::parse_number(std::string_view(port), scpi_port)) {
+            logger.warn("Ignoring invalid SFP_SCPI_PORT", {{"value", port}});
+            scpi_port = 5025;
         }
-        return;
+    }
+    if (scpi_port > 0) {
+        scpi_server.listen_tcp("127.0.0.1", scpi_port);
     }
 
-    // Handle SWITCH:INFO? command (query component information)
-    if (scpi_cmd.rfind("SWITCH:INFO? ", 0) == 0) {
-        std::string switch_num_str = scpi_cmd.substr(13);
-        switch_num_str.erase(switch_num_str.find_last_not_of(" \t\r\n") + 1);
-        
-        // Map switch number to switch ID
-        std::string switch_id = "SW" + switch_num_str;
-        
-        // Load components configuration
-        nlohmann::json components_config = load_json_from_file("components_paths.json");
-        
-        if (!components_config.empty() && components_config.contains("components")) {
-            // Find the requested switch component
-            for (const auto& component : components_config["components"]) {
-                if (component.contains("id") && component["id"].get<std::string>() == switch_id) {
-                    // Store component info for the response (handled in the endpoint)
-                    return;
-                }
-            }
+    // GET /events on its own epoll thread: SFP_EVENTS_PORT (default 8081, 0
+    // disables). /events on the HTTP port redirects there.
+    EventStreamServer event_server(events, sse_state_frame);
+    int events_port = 8081;
+    if (const char* port = std::getenv("SFP_EVENTS_PORT")) {
+        if (!scpi::parse_number(std::string_view(port), events_port)) {
+            logger.warn("Ignoring invalid SFP_EVENTS_PORT", {{"value", port}});
+            events_port = 8081;
         }
-        return;
+    }
+    if (events_port > 0) {
+        event_server.listen_tcp("127.0.0.1", events_port);
     }
 
-    // If we get here, command format was not recognized
-    std::cout << "Unknown command format. Supported commands:" << std::endl;
-    std::cout << "  PATH:SELECT <path_id>" << std::endl;
-    std::cout << "  SWITCH:SELECT <switch_id>" << std::endl;
-    std::cout << "  SWITCH:INFO? <switch_number>" << std::endl;
-}
+    // Without the event server, streams are served by HTTP workers; each
+    // holds one for as long as it is open, so only a quarter of them may
+    const std::size_t max_worker_streams = std::max<std::size_t>(1, http_settings.worker_count() / 4);
+    auto worker_streams = std::make_shared<std::atomic<std::size_t>>(0);
 
-int main() {
-    std::cout << "Starting server..." << std::endl;
     httplib::Server server;
+    http_settings.apply(server);
+    logger.info("HTTP settings", {{"queue", http_settings.queue_name()},
+                                  {"threads", http_settings.worker_count()},
+                                  {"max_queued", http_settings.max_queued},
+                                  {"keep_alive_s", http_settings.keep_alive_s},
+                                  {"keep_alive_max", http_settings.keep_alive_max}});
+    logger.info("HTTP limits", {{"read_timeout_ms", http_settings.read_timeout_ms},
+                                {"write_timeout_ms", http_settings.write_timeout_ms},
+                                {"payload_max", http_settings.payload_max}});
+
+    // Headers and body go out in separate writes; with Nagle on, every
+    // keep-alive request after the first waits out the peer's delayed ACK
+    server.set_tcp_nodelay(true);
 
-    std::cout << "Setting up endpoints..." << std::endl;
+    logger.info("Setting up endpoints...");
     
     // CORS preflight handler
     server.Options("/command", [](const httplib::Request& req, httplib::Response& res) {
@@ -200,144 +218,279 @@ int main() {
 
     // Main command endpoint
     server.Post("/command", [](const httplib::Request& req, httplib::Response& res) {
-        std::cout << "Received request from " << req.remote_addr << ":" << req.remote_port << std::endl;
-        std::cout << "Request body: " << req.body << std::endl;
+        LatencyHistograms::Scope command_timing(latency, kStageCommand);
+        auto started = std::chrono::steady_clock::now();
+        logger.debug("Received request", {{"from", req.remote_addr}, {"port", req.remote_port}, {"body", req.body}});
         
         res.set_header("Access-Control-Allow-Origin", "*");
         res.set_header("Access-Control-Allow-Methods", "POST, OPTIONS");
         res.set_header("Access-Control-Allow-Headers", "Content-Type");
         
+        // Located in place: no DOM, and scpi_command stays a view into req.body
+        command_body::Body body;
+        command_body::Error error;
+        {
+            LatencyHistograms::Scope timing(latency, kStageBodyParse);
+            error = command_body::scan(req.body, body);
+        }
+        switch (error) {
+        case command_body::Error::None:
+            break;
+        case command_body::Error::TooLarge:
+            res.set_content("Invalid request: " + std::string(command_body::describe(error)), "text/plain");
+            res.status = 413;
+            return;
+        case command_body::Error::Malformed:
+            res.set_content("Invalid JSON or error: " + std::string(command_body::describe(error)), "text/plain");
+            res.status = 400;
+            return;
+        default:
+            res.set_content("Invalid request: " + std::string(command_body::describe(error)), "text/plain");
+            res.status = 400;
+            return;
+        }
+        
         try {
-            nlohmann::json body = nlohmann::json::parse(req.body);
-            if (!body.contains("scpi_command")) {
-                res.set_content("Invalid request: Missing 'scpi_command' field", "text/plain");
-                res.status = 400;
-                return;
-            }
+            std::shared_ptr<const RouteTable> routes = current_routes();
+            std::string scratch;  // only used by strings with JSON escapes
             
-            std::string scpi_cmd = body["scpi_command"];
-            
-            // Log all SCPI commands
-            std::cout << "Processing SCPI command: " << scpi_cmd << std::endl;
-            
-            // Special handling for SWITCH:INFO? command
-            if (scpi_cmd.rfind("SWITCH:INFO? ", 0) == 0) {
-                std::string switch_num_str = scpi_cmd.substr(13);
-                switch_num_str.erase(switch_num_str.find_last_not_of(" \t\r\n") + 1);
-                
-                std::string switch_id = "SW" + switch_num_str;
-                
-                // Load components configuration
-                nlohmann::json components_config = load_json_from_file("components_paths.json");
-                
-                nlohmann::json response;
-                response["status"] = "OK";
-                
-                if (!components_config.empty() && components_config.contains("components")) {
-                    // Find the requested switch component
-                    bool component_found = false;
-                    for (const auto& component : components_config["components"]) {
-                        if (component.contains("id") && component["id"].get<std::string>() == switch_id) {
-                            response["component_info"] = component;
-                            response["message"] = "Component information retrieved successfully";
-                            component_found = true;
-                            break;
-                        }
+            // Single command: plain reply object, as before
+            if (!body.batch) {
+                std::string_view scpi_cmd = command_body::decode_string(body.command, scratch);
+                if (scpi_cmd.find(';') == std::string_view::npos) {
+                    scpi::ParsedCommand cmd;
+                    {
+                        LatencyHistograms::Scope timing(latency, kStageScpiParse);
+                        cmd = scpi::parse(scpi_cmd);
                     }
+                    auto pending = switch_scheduler.idle_at();
+                    JsonWriter json(json_buffer);
+                    write_scpi_reply(json, cmd, *routes, pending);
+                    res.set_content(json_buffer.data(), json_buffer.size(), "application/json");
+                    res.status = 200;
                     
-                    if (!component_found) {
-                        response["status"] = "ERROR";
-                        response["message"] = "Component " + switch_id + " not found";
-                    }
-                } else {
-                    response["status"] = "ERROR";
-                    response["message"] = "Failed to load components configuration";
+                    // Log all SCPI commands
+                    logger.info("Processed SCPI command", {{"command", scpi_cmd}, {"latency_us", elapsed_us(started)}});
+                    return;
                 }
-                
-                res.set_content(response.dump(), "application/json");
-                res.status = 200;
-                return;
             }
             
-            // Process other SCPI commands normally
-            process_scpi_command(scpi_cmd);
-            
-            nlohmann::json response;
-            response["status"] = "OK";
-            response["message"] = "Command processed successfully";
-            response["current_path"] = current_path_id;
-            res.set_content(response.dump(), "application/json");
+            // Batch: compound program message ("PATH:SELECT 3;:SWITCH:INFO? 1") or an array
+            // of them, executed in order against one route snapshot
+            JsonWriter json(json_buffer);
+            json.begin_object();
+            json.key(kStatusKey).value("OK");
+            json.key(kResultsKey).begin_array();
+            std::size_t count = 0;
+            auto pending = switch_scheduler.idle_at();
+            auto run = [&](const scpi::ParsedCommand& cmd) {
+                write_scpi_reply(json, cmd, *routes, pending);
+                ++count;
+            };
+            command_body::for_each_string(body.command, scratch, [&](std::string_view message) {
+                scpi::for_each_command(message, run);
+            });
+            json.end_array();
+            json.key(kCurrentPathKey).value(chassis.current_path());
+            json.end_object();
+            res.set_content(json_buffer.data(), json_buffer.size(), "application/json");
             res.status = 200;
+            
+            logger.info("Processed SCPI batch", {{"commands", count}, {"latency_us", elapsed_us(started)}});
         } catch (const std::exception& e) {
             res.set_content("Invalid JSON or error: " + std::string(e.what()), "text/plain");
             res.status = 400;
         }
     });
 
-    // Enhanced configuration endpoint - combines both files
+    // Runtime log level: body is debug, info, warn, error or off
+    server.Post("/log_level", [](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        
+        LogLevel level;
+        if (!Logger::parse_level(req.body, level)) {
+            res.set_content("Invalid log level. Use debug, info, warn, error or off", "text/plain");
+            res.status = 400;
+            return;
+        }
+        logger.set_level(level);
+        
+        nlohmann::json response;
+        response["log_level"] = Logger::level_name(level);
+        res.set_content(response.dump(), "application/json");
+    });
+
+    // Enhanced configuration endpoint - combines both files. Served from the
+    // cached document: pretty by default, ?format=compact for the compact form,
+    // gzip when the client accepts it, 304 when If-None-Match still matches.
     server.Get("/config", [](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Cache-Control", "no-cache");
+        res.set_header("Vary", "Accept-Encoding");
         
-        // Load both configuration files
-        nlohmann::json paths_config = load_json_from_file("paths.json");
-        nlohmann::json components_config = load_json_from_file("components_paths.json");
+        std::shared_ptr<const ConfigDocument> document = current_config_document();
+        const ConfigDocument::Representation& representation =
+            req.get_param_value("format") == "compact" ? document->compact() : document->pretty();
         
-        nlohmann::json combined_config;
+        bool gzip = !representation.gzip.empty() &&
+                    req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos;
+        const std::string& etag = gzip ? representation.gzip_etag : representation.etag;
+        res.set_header("ETag", etag);
         
-        // Add paths from paths.json
-        if (!paths_config.empty() && paths_config.contains("paths")) {
-            combined_config["paths"] = paths_config["paths"];
+        if (ConfigDocument::etag_matches(req.get_header_value("If-None-Match"), etag)) {
+            res.status = 304;
+            return;
+        }
+        if (gzip) {
+            res.set_header("Content-Encoding", "gzip");
+            res.set_content(representation.gzip, "application/json");
         } else {
-            combined_config["paths"] = nlohmann::json::array();
+            res.set_content(representation.body, "application/json");
         }
+    });
+
+    // Change stream: a "state" event with the full chassis state, then one
+    // compact event per change ("path", "switch", "config"). Reconnecting
+    // clients send Last-Event-ID and get only what they missed. Sent on to
+    // the event server when it is listening (EventSource follows the 307);
+    // otherwise each open stream occupies a worker, up to max_worker_streams.
+    server.Get("/events", [&event_server, max_worker_streams, worker_streams](const httplib::Request& req,
+                                                                              httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Cache-Control", "no-cache");
         
-        // Add components from components_paths.json
-        if (!components_config.empty() && components_config.contains("components")) {
-            combined_config["components"] = components_config["components"];
-        } else {
-            combined_config["components"] = nlohmann::json::array();
+        if (int port = event_server.port()) {
+            std::string host = req.get_header_value("Host");
+            std::size_t colon = host.rfind(':');
+            if (colon != std::string::npos && host.find(']', colon) == std::string::npos) {
+                host.erase(colon);
+            }
+            res.set_header("Connection", "close");  // a kept-alive connection would hold a worker idle
+            res.set_redirect("http://" + (host.empty() ? std::string("localhost") : host) + ":" +
+                             std::to_string(port) + "/events", 307);
+            return;
+        }
+        if (worker_streams->fetch_add(1) >= max_worker_streams) {
+            worker_streams->fetch_sub(1);
+            res.status = 503;
+            res.set_header("Retry-After", "5");
+            res.set_content("Too many event streams", "text/plain");
+            return;
         }
         
-        // Add current path information
-        combined_config["current_path"] = current_path_id;
+        // Cursor is read before the state snapshot: a change racing with the
+        // connect is sent twice rather than lost
+        auto cursor = std::make_shared<uint64_t>(events.last_id());
+        auto need_state = std::make_shared<bool>(true);
+        uint64_t resume_from;
+        if (scpi::parse_number(req.get_header_value("Last-Event-ID"), resume_from) && resume_from <= *cursor) {
+            *cursor = resume_from;
+            *need_state = false;
+        }
         
-        res.set_content(combined_config.dump(4), "application/json");
+        res.set_chunked_content_provider("text/event-stream", [cursor, need_state](size_t, httplib::DataSink& sink) {
+            std::string out;
+            std::vector<Event> batch;
+            bool gap = false;
+            if (*need_state) {
+                out = sse_state_frame(*cursor);
+                *need_state = false;
+            } else if (events.wait(*cursor, std::chrono::seconds(15), batch, gap)) {
+                if (gap) {
+                    *cursor = events.last_id();
+                    out = sse_state_frame(*cursor);
+                } else {
+                    for (const Event& event : batch) {
+                        out += sse_frame(event.id, event.type, event.data);
+                    }
+                    *cursor = batch.back().id;
+                }
+            } else {
+                out = ": keep-alive\n\n";  // also detects clients that went away
+            }
+            return sink.write(out.data(), out.size());
+        }, [worker_streams](bool) { worker_streams->fetch_sub(1); });
     });
 
     // Status endpoint to check current path
     server.Get("/status", [](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
         
+        // One consistent view of the chassis, read without locking
+        ChassisState::Snapshot state = chassis.snapshot();
+        
         nlohmann::json status;
-        status["current_path"] = current_path_id;
+        status["current_path"] = state.current_path;
         status["server_status"] = "running";
+        status["state_version"] = state.version;
         
-        // Add file status information
-        std::ifstream paths_file("paths.json");
-        std::ifstream components_file("components_paths.json");
-        
-        status["files"]["paths_json"] = paths_file.good() ? "found" : "missing";
-        status["files"]["components_paths_json"] = components_file.good() ? "found" : "missing";
+        status["switches"] = switches_json(state);
         
-        paths_file.close();
-        components_file.close();
+        // Add file status information from the loaded route table
+        std::shared_ptr<const RouteTable> routes = current_routes();
+        status["files"]["paths_json"] = routes->paths_loaded() ? "found" : "missing";
+        status["files"]["components_paths_json"] = routes->components_loaded() ? "found" : "missing";
         
         res.set_content(status.dump(4), "application/json");
     });
 
-    std::cout << "Attempting to bind to localhost:8080..." << std::endl;
+    // Relay actuation counts, for all switches that have moved or ?switch=SW1
+    server.Get("/odometers", [](const httplib::Request& req, httplib::Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        int only = -1;
+        if (req.has_param("switch")) {
+            only = ChassisState::switch_slot(req.get_param_value("switch"));
+            if (only < 0) {
+                res.status = 400;
+                res.set_content("{\"status\":\"ERROR\",\"message\":\"Unknown switch\"}", "application/json");
+                return;
+            }
+        }
+
+        JsonWriter json(json_buffer);
+        json.begin_object();
+        json.key(kStatusKey).value("OK");
+        json.key(kFileKey).value(odometers.path());
+        json.key(kPersistedSequenceKey).value(odometers.sequence());
+        json.key(kSwitchesKey).begin_array();
+        for (int slot = 0; slot < ChassisState::kMaxSwitches; ++slot) {
+            if (only >= 0 ? slot != only : odometers.total(slot) == 0) {
+                continue;
+            }
+            char switch_id[] = {'S', 'W', static_cast<char>('1' + slot), '\0'};
+            json.begin_object();
+            json.key(kSwitchKey).value(switch_id);
+            json.key(kOdometerKey);
+            write_odometer(json, slot);
+            json.end_object();
+        }
+        json.end_array();
+        json.end_object();
+        res.set_content(json_buffer.data(), json_buffer.size(), "application/json");
+    });
+
+    // Per-stage command latency for Prometheus: p50/p99/p999, sum and count
+    server.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        std::string out;
+        latency.write_prometheus(out, "sfp_command_stage_seconds", "Time spent in each stage of a command.");
+        res.set_content(out, "text/plain; version=0.0.4");
+    });
+
+    logger.info("Attempting to bind to localhost:8080...");
     
     if (!server.listen("localhost", 8080)) {
-        std::cout << "❌ Failed to bind to localhost:8080. Port might be in use." << std::endl;
-        std::cout << "Trying 0.0.0.0:8080..." << std::endl;
+        logger.error("❌ Failed to bind to localhost:8080. Port might be in use.");
+        logger.info("Trying 0.0.0.0:8080...");
         
         if (!server.listen("0.0.0.0", 8080)) {
-            std::cout << "❌ Failed to bind to 0.0.0.0:8080 as well." << std::endl;
-            std::cout << "Please check if port 8080 is already in use." << std::endl;
+            logger.error("❌ Failed to bind to 0.0.0.0:8080 as well.");
+            logger.error("Please check if port 8080 is already in use.");
+            logger.flush();
             return 1;
         }
     }
     
-    std::cout << "✅ Server is running successfully!" << std::endl;
+    logger.info("✅ Server is running successfully!");
+    logger.flush();
     return 0;
 }
\ No newline at end of file
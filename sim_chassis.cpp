@@ -0,0 +1,213 @@
+// Simulated switch chassis in POSIX shared memory (controller/sim_chassis.hpp).
+//
+//   sim_chassis serve   [--name /sfp_chassis] [--settle-ms 150] [--base 0x10000000] [--size 0x10000]
+//   sim_chassis monitor [--name /sfp_chassis]
+//   sim_chassis settle  <ms> [--name /sfp_chassis]
+//   sim_chassis load    [--name /sfp_chassis] [--threads 4] [--seconds 2]
+//
+// serve creates the segment and reports activity once a second until
+// Ctrl-C; point the controller at it with SFP_REGISTERS=chassis:/sfp_chassis.
+// monitor prints every register that has been written, with its odometer.
+// load hammers the registers from this process to measure raw throughput.
+//
+// Build: g++ sim_chassis.cpp controller/sim_chassis.cpp -std=c++17 -O2 -pthread -o sim_chassis
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "controller/sim_chassis.hpp"
+
+namespace {
+
+struct Options {
+    std::string name = "/sfp_chassis";
+    long long settle_ms = 150;
+    unsigned long long base = 0x10000000;
+    unsigned long long size = 0x10000;
+    int threads = 4;
+    int seconds = 2;
+    std::vector<std::string> positional;
+};
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--name" && has_value) {
+            options.name = argv[++i];
+        } else if (arg == "--settle-ms" && has_value) {
+            options.settle_ms = std::strtoll(argv[++i], nullptr, 0);
+        } else if (arg == "--base" && has_value) {
+            options.base = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--size" && has_value) {
+            options.size = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "--seconds" && has_value) {
+            options.seconds = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return false;
+        } else {
+            options.positional.push_back(arg);
+        }
+    }
+    return true;
+}
+
+std::atomic<bool> stop_requested(false);
+
+void on_signal(int) {
+    stop_requested = true;
+}
+
+int serve(const Options& options) {
+    std::string error;
+    auto chassis = SimChassis::create(options.name, static_cast<std::uint32_t>(options.base),
+                                      static_cast<std::size_t>(options.size),
+                                      std::chrono::milliseconds(options.settle_ms), error);
+    if (!chassis) {
+        std::cerr << "Cannot create chassis: " << error << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::cout << "Chassis " << options.name << " ready: base 0x" << std::hex << chassis->base() << std::dec
+              << ", " << chassis->size() << " bytes, settle " << options.settle_ms << " ms" << std::endl;
+
+    SimChassis::Stats last = chassis->stats();
+    while (!stop_requested) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        SimChassis::Stats now = chassis->stats();
+        if (now.writes != last.writes) {
+            std::cout << "writes/s " << now.writes - last.writes << ", actuations/s " << now.actuations - last.actuations
+                      << ", overlapped " << now.overlapped << " (total writes " << now.writes << ")" << std::endl;
+        }
+        last = now;
+    }
+    SimChassis::remove(options.name);
+    std::cout << "Chassis " << options.name << " removed" << std::endl;
+    return 0;
+}
+
+int monitor(const Options& options) {
+    std::string error;
+    auto chassis = SimChassis::attach(options.name, error);
+    if (!chassis) {
+        std::cerr << "Cannot attach: " << error << std::endl;
+        return 1;
+    }
+    SimChassis::Stats stats = chassis->stats();
+    std::cout << "settle " << std::chrono::duration<double, std::milli>(chassis->settle_time()).count() << " ms, writes "
+              << stats.writes << ", actuations " << stats.actuations << ", overlapped " << stats.overlapped << "\n";
+    std::cout << std::left << std::setw(12) << "address" << std::setw(12) << "hex" << std::setw(7) << "value"
+              << std::setw(10) << "odometer" << "busy\n";
+    for (std::size_t offset = 0; offset < chassis->size(); ++offset) {
+        std::uint32_t addr = chassis->base() + static_cast<std::uint32_t>(offset);
+        std::uint8_t value = 0;
+        std::uint32_t odometer = 0;
+        chassis->read(addr, value);
+        chassis->odometer(addr, odometer);
+        if (value == 0 && odometer == 0) {
+            continue;
+        }
+        std::ostringstream hex;
+        hex << "0x" << std::hex << addr;
+        std::cout << std::setw(12) << addr << std::setw(12) << hex.str() << std::setw(7) << static_cast<int>(value)
+                  << std::setw(10) << odometer << (chassis->busy(addr) ? "yes" : "no") << "\n";
+    }
+    std::cout << std::flush;
+    return 0;
+}
+
+int settle(const Options& options) {
+    if (options.positional.empty()) {
+        std::cerr << "Usage: sim_chassis settle <ms> [--name /sfp_chassis]" << std::endl;
+        return 1;
+    }
+    std::string error;
+    auto chassis = SimChassis::attach(options.name, error);
+    if (!chassis) {
+        std::cerr << "Cannot attach: " << error << std::endl;
+        return 1;
+    }
+    chassis->set_settle_time(std::chrono::milliseconds(std::strtoll(options.positional[0].c_str(), nullptr, 0)));
+    std::cout << "settle " << std::chrono::duration<double, std::milli>(chassis->settle_time()).count() << " ms"
+              << std::endl;
+    return 0;
+}
+
+// Every thread flips its own register between two values, so each write is an actuation
+int load(const Options& options) {
+    std::string error;
+    auto chassis = SimChassis::attach(options.name, error);
+    if (!chassis) {
+        std::cerr << "Cannot attach: " << error << std::endl;
+        return 1;
+    }
+    int threads = options.threads > 0 ? options.threads : 1;
+    std::atomic<bool> done(false);
+    std::vector<std::uint64_t> counts(static_cast<std::size_t>(threads));
+    std::vector<std::thread> workers;
+    SimChassis::Stats before = chassis->stats();
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            // 64 bytes apart so the threads do not share a cache line
+            std::uint32_t addr = chassis->base() + static_cast<std::uint32_t>((static_cast<std::size_t>(t) * 64) % chassis->size());
+            std::uint64_t n = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 1024; ++i) {
+                    chassis->write(addr, static_cast<std::uint8_t>(1 + (n++ & 1)));
+                }
+            }
+            counts[static_cast<std::size_t>(t)] = n;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    done = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::uint64_t total = 0;
+    for (std::uint64_t n : counts) {
+        total += n;
+    }
+    SimChassis::Stats after = chassis->stats();
+    std::cout << threads << " threads: " << static_cast<long long>(total / seconds) << " writes/s, "
+              << (after.actuations - before.actuations) << " actuations" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string command = argc > 1 ? argv[1] : "";
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 1;
+    }
+    if (command == "serve") {
+        return serve(options);
+    }
+    if (command == "monitor") {
+        return monitor(options);
+    }
+    if (command == "settle") {
+        return settle(options);
+    }
+    if (command == "load") {
+        return load(options);
+    }
+    std::cerr << "Usage: sim_chassis serve|monitor|settle|load [options]" << std::endl;
+    return 1;
+}